@@ -3,6 +3,7 @@
 
 #include "id/pid.hpp"
 
+#include <cstddef>
 #include <string>
 
 namespace dvl
@@ -32,22 +33,41 @@ namespace dvl
 		pid id;
 
 		/**
-		 * The message associated with this exception
+		 * The message associated with this exception, if it isn't static
 		 */
 		std::string msg;
+
+		/**
+		 * The message associated with this exception, if it is a string-literal
+		 */
+		const char *static_msg = nullptr;
 	public:
 		/**
 		 * Constructs a new parser-exception of the given parameters
 		 */
 		parser_exception(const pid id, std::string msg): id(id), msg(msg){}
 
+		/**
+		 * Constructs a new parser-exception with a string-literal as message. The literal
+		 * isn't copied, thus neither constructing nor copying the exception allocates.
+		 * Messages passed as const char* are copied.
+		 */
+		template<std::size_t N>
+		parser_exception(const pid id, const char (&msg)[N]): id(id), static_msg(msg){}
+
+		/**
+		 * Constructs a new parser-exception with a copy of the message in the buffer
+		 */
+		template<std::size_t N>
+		parser_exception(const pid id, char (&msg)[N]): id(id), msg(msg){}
+
 		/**
 		 * Returns the error-message of this exception
 		 *
 		 * @return the error message of this exception
 		 * @see std::exception::what
 		 */
-		const char* what() const throw() {return msg.c_str();}
+		const char* what() const throw() {return static_msg != nullptr ? static_msg : msg.c_str();}
 
 		/**
 		 * Getter for the pid associated with this exception. The result will usually
@@ -66,7 +86,7 @@ namespace dvl
 		 */
 		virtual parser_exception* clone() const
 		{
-			return new parser_exception(id, msg);
+			return new parser_exception(*this);
 		}
 
 		//////////////////////////////////
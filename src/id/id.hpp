@@ -234,10 +234,13 @@ namespace dvl
 		{
 			if(depth == 0)
 				return name_set ? &name : nullptr;
-			else if(c.count(_id.template get<sizeof...(split) - level>()))
-				return c[_id.template get<sizeof...(split) - level>()]._get_name(_id, depth - 1);
-			else
+
+			auto iter = c.find(_id.template get<sizeof...(split) - level>());
+
+			if(iter == c.end())
 				return nullptr;
+			else
+				return iter->second._get_name(_id, depth - 1);
 		}
 
 		void _set_name(id<T, split...> _id, int depth, std::wstring str)
@@ -7,15 +7,26 @@
 const std::wstring
 dvl::pid_table::UNKNOWN = L"Unknown";
 
-const std::map<uint8_t, std::wstring>
-dvl::pid_table::types = {{TYPE_INTERNAL,			L"TYPE_INTERNAL"},
-						 {TYPE_FORK, 				L"TYPE_FORK"},
-					 	 {TYPE_LOOP,				L"TYPE_LOOP"},
-					 	 {TYPE_STRUCT,				L"TYPE_STRUCT"},
-					 	 {TYPE_STRING_MATCHER,		L"TYPE_STRING_MATCHER"},
-						 {TYPE_EMPTY,				L"TYPE_EMPTY"},
-						 {TYPE_CHARSET, 			L"TYPE_CHARSET"},
-						 {TYPE_REGEX, 				L"TYPE_REGEX"}};
+const std::array<std::wstring, 256>
+dvl::pid_table::types = [](){
+	std::array<std::wstring, 256> t;
+
+	t[TYPE_INTERNAL] = L"TYPE_INTERNAL";
+	t[TYPE_FORK] = L"TYPE_FORK";
+	t[TYPE_LOOP] = L"TYPE_LOOP";
+	t[TYPE_STRUCT] = L"TYPE_STRUCT";
+	t[TYPE_STRING_MATCHER] = L"TYPE_STRING_MATCHER";
+	t[TYPE_EMPTY] = L"TYPE_EMPTY";
+	t[TYPE_CHARSET] = L"TYPE_CHARSET";
+	t[TYPE_REGEX] = L"TYPE_REGEX";
+	t[TYPE_LAMBDA] = L"TYPE_LAMBDA";
+	t[TYPE_INLINE] = L"TYPE_INLINE";
+	t[TYPE_DELIMITED] = L"TYPE_DELIMITED";
+	t[TYPE_SEQUENCE] = L"TYPE_SEQUENCE";
+	t[TYPE_PREDICATE] = L"TYPE_PREDICATE";
+
+	return t;
+}();
 
 dvl::pid_table::pid_table()
 {
@@ -24,6 +35,8 @@ dvl::pid_table::pid_table()
 
 	set_element(EMPTY, L"EMPTY");
 	set_element(PARSER, L"PARSER");
+	set_element(SERIALIZER, L"SERIALIZER");
+	set_element(PARSE_ERROR, L"PARSE_ERROR");
 
 	//register diagnostic routines
 	set_group(pid().set_group(GROUP_DIAGNOSTIC), L"DIAGNOSTIC");
@@ -198,7 +198,7 @@ namespace dvl
 		 *
 		 * @see get_type
 		 */
-		static const std::map<uint8_t, std::wstring> types;
+		static const std::array<std::wstring, 256> types;
 
 		/**
 		 * getter for an element of the name of a id. Returns @link UNKNOWN, if there
@@ -281,10 +281,9 @@ namespace dvl
 		 * @see UNKNOWN
 		 */
 		const std::wstring& get_type(pid id){
-			if(types.count(id.get_type()))
-				return types.at(id.get_type());
-			else
-				return UNKNOWN;
+			const std::wstring &name = types[id.get_type()];
+
+			return name.empty() ? UNKNOWN : name;
 		}
 
 		/**
@@ -391,16 +390,12 @@ namespace dvl
 					TYPE_CHARSET = 6,
 
 	/**
-	 * <em> Reserved for future use. At the moment this type remains unused, but reserved </em>
-	 *
 	 * type-identifier associated with regex-routines
 	 *
 	 * @see pid
 	 * @see pid_table
 	 * @see regex_routine
 	 * @see pid_table.types
-	 *
-	 * TODO mark for future use (doxygen tag???)
 	 */
 					TYPE_REGEX = 7,
 
@@ -413,6 +408,47 @@ namespace dvl
 	 * @see lambda_routine
 	 */
 					TYPE_LAMBDA = 8,
+
+	/**
+	 * type-identifier associated with inline_routines
+	 *
+	 * @see pid
+	 * @see pid_table
+	 * @see pid_table.types
+	 * @see inline_routine
+	 */
+					TYPE_INLINE = 9,
+
+	/**
+	 * type-identifier associated with delimited_routines
+	 *
+	 * @see pid
+	 * @see pid_table
+	 * @see pid_table.types
+	 * @see delimited_routine
+	 */
+					TYPE_DELIMITED = 10,
+
+	/**
+	 * type-identifier associated with sequence_routines
+	 *
+	 * @see pid
+	 * @see pid_table
+	 * @see pid_table.types
+	 * @see sequence_routine
+	 */
+					TYPE_SEQUENCE = 11,
+
+	/**
+	 * type-identifier associated with predicate_routines
+	 *
+	 * @see pid
+	 * @see pid_table
+	 * @see pid_table.types
+	 * @see predicate_routine
+	 */
+					TYPE_PREDICATE = 12,
+
 	/**
 	 * the type-identifier associated with internal ids used for the
 	 * parser itself and diagnostic routines.
@@ -486,6 +522,26 @@ namespace dvl
 	 * @see parser_tree_builder
 	 */
 				LOOP_HELPER = pid({GROUP_INTERNAL, 3l, TYPE_INTERNAL}),
+	/**
+	 * Identifies errors raised while reading or writing serialized output of the parser.
+	 * Group = GROUP_INTERNAL, Element = 4, Type = TYPE_INTERNAL
+	 *
+	 * @see GROUP_INTERNAL
+	 * @see TYPE_INTERNAL
+	 * @see binary_tree_writer
+	 * @see binary_tree_reader
+	 */
+				SERIALIZER = pid({GROUP_INTERNAL, 4l, TYPE_INTERNAL}),
+	/**
+	 * Identifies the nodes inserted by the parser in place of input it skipped while
+	 * recovering from an error.
+	 * Group = GROUP_INTERNAL, Element = 5, Type = TYPE_INTERNAL. Elementname = "PARSE_ERROR"
+	 *
+	 * @see GROUP_INTERNAL
+	 * @see TYPE_INTERNAL
+	 * @see parser_context::sync
+	 */
+				PARSE_ERROR = pid({GROUP_INTERNAL, 5l, TYPE_INTERNAL}),
 	/**
 	 * Identifies echo-routines.
 	 * Group = GROUP_DIAGNOSTIC, Element = 0, Type = TYPE_INTERNAL
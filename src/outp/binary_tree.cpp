@@ -0,0 +1,348 @@
+#include "binary_tree.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////
+// binary_tree_writer
+//
+
+dvl::binary_tree_writer::binary_tree_writer(std::ostream &out, pid_table *names):
+	out(out),
+	names(names),
+	open{{0, 0}}
+{
+	out.write(binary_format::MAGIC, 4);
+	offset += 4;
+
+	write_fixed(binary_format::VERSION, 2);
+	write_fixed(0, 2);
+}
+
+uint64_t
+dvl::binary_tree_writer::index_of(const pid &id)
+{
+	auto it = pid_index.find(id);
+
+	if(it != pid_index.end())
+		return it->second;
+
+	pids.push_back(id);
+	pid_index[id] = pids.size() - 1;
+
+	return pids.size() - 1;
+}
+
+void
+dvl::binary_tree_writer::write_varint(uint64_t v)
+{
+	char buf[10];
+	int n = 0;
+
+	do{
+		buf[n] = v & 0x7F;
+		v >>= 7;
+
+		if(v)
+			buf[n] |= 0x80;
+
+		n++;
+	}while(v);
+
+	out.write(buf, n);
+	offset += n;
+}
+
+void
+dvl::binary_tree_writer::write_fixed(uint64_t v, int bytes)
+{
+	char buf[8];
+
+	for(int i = 0; i < bytes; i++)
+		buf[i] = (v >> (8 * i)) & 0xFF;
+
+	out.write(buf, bytes);
+	offset += bytes;
+}
+
+void
+dvl::binary_tree_writer::write_string(const std::wstring &str)
+{
+	write_varint(str.size());
+
+	for(wchar_t c : str)
+		write_varint((uint64_t) c);
+}
+
+void
+dvl::binary_tree_writer::write_start(long start)
+{
+	open_node &parent = open.back();
+
+	write_varint(binary_format::zigzag(start - parent.last));
+	parent.last = start;
+}
+
+void
+dvl::binary_tree_writer::enter(const pid &id, long start)
+	throw(parser_exception)
+{
+	if(finished)
+		throw parser_exception(SERIALIZER, "Writer is already finished");
+
+	write_varint(index_of(id) << 2 | binary_format::ENTER);
+	write_start(start);
+
+	open.push_back({start, start});
+	node_ct++;
+}
+
+void
+dvl::binary_tree_writer::exit(const pid &, long start, long end)
+	throw(parser_exception)
+{
+	if(open.size() < 2)
+		throw parser_exception(SERIALIZER, "No open node");
+
+	write_varint(binary_format::EXIT);
+	write_varint(binary_format::zigzag(end - start));
+
+	open.pop_back();
+	open.back().last = end;
+}
+
+void
+dvl::binary_tree_writer::token(const pid &id, long start, long end)
+	throw(parser_exception)
+{
+	if(finished)
+		throw parser_exception(SERIALIZER, "Writer is already finished");
+
+	write_varint(index_of(id) << 2 | binary_format::TOKEN);
+	write_start(start);
+	write_varint(binary_format::zigzag(end - start));
+
+	open.back().last = end;
+	node_ct++;
+}
+
+void
+dvl::binary_tree_writer::write(const flat_tree &t)
+	throw(parser_exception)
+{
+	struct visitor
+	{
+		binary_tree_writer &w;
+
+		void enter(const flat_tree &t, flat_tree::index i)
+		{
+			if(t.get_child(i) != flat_tree::NONE)
+				w.enter(t.get_pid(i), t.get_start(i));
+		}
+
+		void exit(const flat_tree &t, flat_tree::index i)
+		{
+			if(t.get_child(i) != flat_tree::NONE)
+				w.exit(t.get_pid(i), t.get_start(i), t.get_end(i));
+			else
+				w.token(t.get_pid(i), t.get_start(i), t.get_end(i));
+		}
+	} v{*this};
+
+	t.visit(v);
+}
+
+void
+dvl::binary_tree_writer::finish()
+	throw(parser_exception)
+{
+	if(finished)
+		return;
+	else if(open.size() > 1)
+		throw parser_exception(SERIALIZER, "Unclosed nodes");
+
+	finished = true;
+
+	uint64_t dict = offset;
+
+	write_varint(pids.size());
+	for(const pid &id : pids)
+		write_varint(id);
+
+	if(names != nullptr)
+		for(const pid &id : pids)
+		{
+			write_string(names->get_group(id));
+			write_string(names->get_element(id));
+		}
+
+	write_fixed(node_ct, 8);
+	write_fixed(dict, 8);
+	write_fixed(names != nullptr ? binary_format::NAMES : 0, 4);
+	out.write(binary_format::MAGIC, 4);
+
+	out.flush();
+
+	if(!out)
+		throw parser_exception(SERIALIZER, "Failed to write output");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// binary_tree_reader
+//
+
+namespace
+{
+	uint64_t read_fixed(const unsigned char *p, int bytes)
+	{
+		uint64_t v = 0;
+
+		for(int i = 0; i < bytes; i++)
+			v |= (uint64_t) p[i] << (8 * i);
+
+		return v;
+	}
+}
+
+dvl::binary_tree_reader::binary_tree_reader(const std::string &path)
+	throw(parser_exception):
+	data(nullptr),
+	len(0),
+	mapped(true)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+		throw parser_exception(SERIALIZER, "Can't open file " + path);
+
+	struct stat st;
+	if(fstat(fd, &st) < 0 || st.st_size == 0)
+	{
+		close(fd);
+		throw parser_exception(SERIALIZER, "Invalid file " + path);
+	}
+
+	void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(m == MAP_FAILED)
+		throw parser_exception(SERIALIZER, "Can't map file " + path);
+
+	data = (const unsigned char*) m;
+	len = st.st_size;
+
+	try{
+		open();
+	}catch(parser_exception &e)
+	{
+		munmap((void*) data, len);
+		throw;
+	}
+}
+
+dvl::binary_tree_reader::binary_tree_reader(const void *data, std::size_t len)
+	throw(parser_exception):
+	data((const unsigned char*) data),
+	len(len),
+	mapped(false)
+{
+	open();
+}
+
+dvl::binary_tree_reader::~binary_tree_reader()
+{
+	if(mapped)
+		munmap((void*) data, len);
+}
+
+void
+dvl::binary_tree_reader::open()
+	throw(parser_exception)
+{
+	using namespace binary_format;
+
+	if(len < HEADER_SIZE + FOOTER_SIZE || memcmp(data, MAGIC, 4) ||
+			memcmp(data + len - 4, MAGIC, 4))
+		throw parser_exception(SERIALIZER, "Not a binary tree");
+
+	if(read_fixed(data + 4, 2) != VERSION)
+		throw parser_exception(SERIALIZER, "Unsupported version");
+
+	const unsigned char *footer = data + len - FOOTER_SIZE;
+
+	node_ct = read_fixed(footer, 8);
+	body_end = read_fixed(footer + 8, 8);
+	flags = read_fixed(footer + 16, 4);
+
+	if(body_end < HEADER_SIZE || body_end > len - FOOTER_SIZE)
+		throw parser_exception(SERIALIZER, "Invalid dictionary-offset");
+
+	const unsigned char *p = data + body_end;
+	uint64_t ct = read_varint(p, footer);
+
+	if(ct > (uint64_t) (footer - p))
+		throw parser_exception(SERIALIZER, "Invalid dictionary-size");
+
+	pids.reserve(ct);
+	for(uint64_t i = 0; i < ct; i++)
+		pids.push_back(pid(read_varint(p, footer)));
+}
+
+void
+dvl::binary_tree_reader::load_names(pid_table &t) const
+	throw(parser_exception)
+{
+	if(!has_names())
+		return;
+
+	const unsigned char *p = data + body_end, *end = data + len - binary_format::FOOTER_SIZE;
+
+	// skip pids
+	for(uint64_t i = binary_format::read_varint(p, end); i > 0; i--)
+		binary_format::read_varint(p, end);
+
+	auto read_string = [&p, end]()->std::wstring{
+		std::wstring str;
+
+		for(uint64_t n = binary_format::read_varint(p, end); n > 0; n--)
+			str.push_back((wchar_t) binary_format::read_varint(p, end));
+
+		return str;
+	};
+
+	for(const pid &id : pids)
+	{
+		t.set_group(id, read_string());
+		t.set_element(id, read_string());
+	}
+}
+
+dvl::flat_tree
+dvl::binary_tree_reader::to_flat_tree() const
+	throw(parser_exception)
+{
+	struct visitor
+	{
+		flat_tree_builder b;
+
+		void enter(const pid &id, long start){ b.enter(id, start); }
+
+		void exit(const pid &, long, long end){ b.exit(end); }
+
+		void token(const pid &id, long start, long end)
+		{
+			b.enter(id, start);
+			b.exit(end);
+		}
+	} v;
+
+	// node_ct is untrusted, each node requires at least two bytes
+	v.b.reserve(std::min<uint64_t>(node_ct, body_end / 2));
+	visit(v);
+
+	return v.b.release();
+}
@@ -0,0 +1,379 @@
+#ifndef OUTP_BINARY_TREE_HPP_
+#define OUTP_BINARY_TREE_HPP_
+
+#include "../ex.hpp"
+#include "../id/pid.hpp"
+#include "event_stream.hpp"
+#include "flat_tree.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// binary format
+	//
+
+	/**
+	 * Constants of the binary serialization format of parse-trees. A file consists of
+	 *
+	 * <ul>
+	 * 	<li>a header of HEADER_SIZE bytes: the magic "DVLT" followed by the version
+	 * 		(uint16) and two reserved bytes</li>
+	 * 	<li>the nodes in preorder, encoded as records (see below)</li>
+	 * 	<li>the pid-dictionary: the number of distinct pids followed by the raw value of each pid.
+	 * 		If NAMES is set, the group- and element-name of each pid follow.</li>
+	 * 	<li>a footer of FOOTER_SIZE bytes: the number of nodes (uint64), the offset of the
+	 * 		dictionary (uint64), flags (uint32) and the magic</li>
+	 * </ul>
+	 *
+	 * Fixed-size integers are stored little-endian, all other integers are LEB128-varints.
+	 * Each record starts with a tag, whose lower two bits specify the kind of the record and
+	 * whose remaining bits hold the index of the pid in the dictionary:
+	 *
+	 * <ul>
+	 * 	<li>ENTER: followed by the start of the node</li>
+	 * 	<li>EXIT: closes the last entered node and is followed by its length</li>
+	 * 	<li>TOKEN: a node without children, followed by start and length</li>
+	 * </ul>
+	 *
+	 * Starts are stored relative to the end of the previous sibling or the start of the parent,
+	 * if the node is the first child. Both starts and lengths are zigzag-encoded. Strings are
+	 * stored as length followed by the code-points.
+	 *
+	 * Since the dictionary is written after the nodes, a tree can be written while parsing.
+	 *
+	 * @see binary_tree_writer
+	 * @see binary_tree_reader
+	 */
+	namespace binary_format
+	{
+		const char MAGIC[4] = {'D', 'V', 'L', 'T'};
+
+		const uint16_t VERSION = 1;
+
+		const std::size_t HEADER_SIZE = 8,
+						FOOTER_SIZE = 24;
+
+		/**
+		 * record-kinds
+		 */
+		const unsigned int EXIT = 0,
+						ENTER = 1,
+						TOKEN = 2;
+
+		/**
+		 * flags
+		 */
+		const uint32_t NAMES = 1;
+
+		inline uint64_t zigzag(long v){ return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63); }
+
+		inline long unzigzag(uint64_t v){ return (long) (v >> 1) ^ -(long) (v & 1); }
+
+		/**
+		 * Decodes a varint at p and advances p
+		 *
+		 * @throws parser_exception if the varint exceeds end
+		 */
+		inline uint64_t read_varint(const unsigned char *&p, const unsigned char *end)
+			throw(parser_exception)
+		{
+			uint64_t v = 0;
+
+			for(int shift = 0; shift < 64; shift += 7)
+			{
+				if(p >= end)
+					throw parser_exception(SERIALIZER, "Truncated varint");
+
+				unsigned char c = *p++;
+				v |= (uint64_t) (c & 0x7F) << shift;
+
+				if(!(c & 0x80))
+					return v;
+			}
+
+			throw parser_exception(SERIALIZER, "Invalid varint");
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+	// binary_tree_writer
+	//
+
+	/**
+	 * Writes a parse-tree in the binary format to a stream. The writer is an event_sink and
+	 * can thus be attached to a parser via event_stream to write the output while parsing.
+	 * Alternatively complete trees can be written via write.
+	 *
+	 * The output is only valid after finish was called.
+	 *
+	 * @see binary_format
+	 * @see binary_tree_reader
+	 */
+	class binary_tree_writer : public event_sink
+	{
+	private:
+		struct open_node
+		{
+			long start;
+
+			/**
+			 * position relative to which the start of the next child is stored
+			 */
+			long last;
+		};
+
+		std::ostream &out;
+
+		/**
+		 * optional table used to resolve the names of pids
+		 */
+		pid_table *names;
+
+		/**
+		 * dictionary of pids and their indices
+		 */
+		std::vector<pid> pids;
+		std::unordered_map<uint64_t, uint64_t> pid_index;
+
+		/**
+		 * open nodes. The bottom-most element is a placeholder for the list of roots.
+		 */
+		std::vector<open_node> open;
+
+		uint64_t node_ct = 0;
+
+		/**
+		 * bytes written so far
+		 */
+		uint64_t offset = 0;
+
+		bool finished = false;
+
+		uint64_t index_of(const pid &id);
+
+		void write_varint(uint64_t v);
+
+		void write_fixed(uint64_t v, int bytes);
+
+		void write_string(const std::wstring &str);
+
+		/**
+		 * writes the start of a node relative to the parent and updates the parent
+		 */
+		void write_start(long start);
+	public:
+		/**
+		 * Creates a new writer and writes the header. The stream should be opened in
+		 * binary mode.
+		 *
+		 * @param out the stream to write to
+		 * @param names if not null, the names of all pids are included in the output
+		 */
+		binary_tree_writer(std::ostream &out, pid_table *names = nullptr);
+
+		void enter(const pid &id, long start)
+			throw(parser_exception);
+
+		void exit(const pid &id, long start, long end)
+			throw(parser_exception);
+
+		void token(const pid &id, long start, long end)
+			throw(parser_exception);
+
+		/**
+		 * Writes all nodes of a flat_tree
+		 */
+		void write(const flat_tree &t)
+			throw(parser_exception);
+
+		/**
+		 * Writes dictionary and footer. No further nodes may be written afterwards.
+		 *
+		 * @throws parser_exception if there are unclosed nodes
+		 */
+		void finish()
+			throw(parser_exception);
+
+		/**
+		 * @return number of nodes written so far
+		 */
+		uint64_t size() const { return node_ct; }
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// binary_tree_reader
+	//
+
+	/**
+	 * Provides access to a parse-tree in the binary format. Files are mapped into memory and
+	 * the nodes are decoded while traversing, thus opening a file only requires reading the
+	 * dictionary.
+	 *
+	 * @see binary_format
+	 * @see binary_tree_writer
+	 */
+	class binary_tree_reader
+	{
+	private:
+		const unsigned char *data;
+		std::size_t len;
+
+		/**
+		 * true if data was mapped by this reader
+		 */
+		bool mapped;
+
+		std::vector<pid> pids;
+
+		/**
+		 * end of the records and start of the dictionary
+		 */
+		std::size_t body_end;
+
+		uint64_t node_ct;
+		uint32_t flags;
+
+		/**
+		 * validates header and footer and loads the dictionary
+		 */
+		void open()
+			throw(parser_exception);
+
+		const pid &pid_at(uint64_t i) const
+			throw(parser_exception)
+		{
+			if(i >= pids.size())
+				throw parser_exception(SERIALIZER, "Invalid pid-index");
+
+			return pids[i];
+		}
+	public:
+		/**
+		 * Maps the specified file into memory
+		 *
+		 * @param path the file to open
+		 * @throws parser_exception if the file can't be mapped or isn't valid
+		 */
+		explicit binary_tree_reader(const std::string &path)
+			throw(parser_exception);
+
+		/**
+		 * Reads a tree from memory. The memory must remain valid for the lifetime of
+		 * the reader.
+		 *
+		 * @throws parser_exception if the data isn't valid
+		 */
+		binary_tree_reader(const void *data, std::size_t len)
+			throw(parser_exception);
+
+		binary_tree_reader(const binary_tree_reader&) = delete;
+		binary_tree_reader &operator=(const binary_tree_reader&) = delete;
+
+		~binary_tree_reader();
+
+		/**
+		 * @return the number of nodes in the tree
+		 */
+		uint64_t size() const { return node_ct; }
+
+		/**
+		 * @return the distinct pids occurring in the tree
+		 */
+		const std::vector<pid> &get_pids() const { return pids; }
+
+		/**
+		 * @return true if the file contains the names of the pids
+		 */
+		bool has_names() const { return flags & binary_format::NAMES; }
+
+		/**
+		 * Registers the names stored in the file in the given table. Does nothing if
+		 * the file doesn't contain names.
+		 */
+		void load_names(pid_table &t) const
+			throw(parser_exception);
+
+		/**
+		 * Traverses the tree in preorder. The visitor must provide the methods of event_sink,
+		 * i.e. <code>enter(const pid&, long)</code>, <code>exit(const pid&, long, long)</code>
+		 * and <code>token(const pid&, long, long)</code>.
+		 *
+		 * @param v the visitor
+		 * @throws parser_exception if the data is malformed
+		 */
+		template<typename V>
+		void visit(V &v) const
+			throw(parser_exception)
+		{
+			using namespace binary_format;
+
+			struct open_node
+			{
+				uint64_t id;
+				long start;
+			};
+
+			const unsigned char *p = data + HEADER_SIZE, *end = data + body_end;
+
+			std::vector<open_node> st;
+			long last = 0;
+
+			while(p < end)
+			{
+				uint64_t tag = read_varint(p, end);
+
+				switch(tag & 3)
+				{
+				case ENTER:
+				{
+					long start = last + unzigzag(read_varint(p, end));
+					v.enter(pid_at(tag >> 2), start);
+
+					st.push_back({tag >> 2, start});
+					last = start;
+					break;
+				}
+				case EXIT:
+				{
+					if(st.empty())
+						throw parser_exception(SERIALIZER, "Unbalanced exit");
+
+					open_node n = st.back();
+					st.pop_back();
+
+					last = n.start + unzigzag(read_varint(p, end));
+					v.exit(pid_at(n.id), n.start, last);
+					break;
+				}
+				case TOKEN:
+				{
+					long start = last + unzigzag(read_varint(p, end));
+					last = start + unzigzag(read_varint(p, end));
+
+					v.token(pid_at(tag >> 2), start, last);
+					break;
+				}
+				default:
+					throw parser_exception(SERIALIZER, "Invalid record");
+				}
+			}
+
+			if(!st.empty())
+				throw parser_exception(SERIALIZER, "Unclosed node");
+		}
+
+		/**
+		 * Decodes the tree into a flat_tree
+		 */
+		flat_tree to_flat_tree() const
+			throw(parser_exception);
+	};
+}
+
+#endif /* OUTP_BINARY_TREE_HPP_ */
@@ -0,0 +1,79 @@
+#include "event_stream.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// event_stream
+//
+
+void
+dvl::event_stream::enter(const pid &id, long start)
+{
+	buffer.push_back({true, id, start, start, node_ct});
+	open.push_back({id, start, node_ct});
+
+	node_ct++;
+}
+
+void
+dvl::event_stream::exit(long end)
+{
+	if(open.empty())
+		return;
+
+	open_node &n = open.back();
+	buffer.push_back({false, n.id, n.start, end, n.node});
+	open.pop_back();
+}
+
+void
+dvl::event_stream::rewind(std::size_t mark)
+{
+	if(mark >= node_ct)
+		return;
+
+	node_ct = mark;
+
+	// events of nodes >= mark are always at the end of the buffer
+	while(!buffer.empty() && buffer.back().node >= mark)
+		buffer.pop_back();
+
+	while(!open.empty() && open.back().node >= mark)
+		open.pop_back();
+}
+
+void
+dvl::event_stream::commit(std::size_t mark)
+{
+	flush(mark);
+}
+
+void
+dvl::event_stream::flush(std::size_t mark)
+{
+	while(!buffer.empty() && buffer.front().node < mark)
+	{
+		event &e = buffer.front();
+
+		if(!e.enter)
+		{
+			sink.exit(e.id, e.start, e.end);
+			buffer.pop_front();
+			continue;
+		}
+
+		// keep the last enter, until it's known whether the node has children
+		if(buffer.size() == 1 && !open.empty() && open.back().node == e.node)
+			break;
+
+		if(buffer.size() > 1 && !buffer[1].enter && buffer[1].node == e.node)
+		{
+			sink.token(e.id, e.start, buffer[1].end);
+			buffer.pop_front();
+			buffer.pop_front();
+		}
+		else
+		{
+			sink.enter(e.id, e.start);
+			buffer.pop_front();
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef OUTP_EVENT_STREAM_HPP_
+#define OUTP_EVENT_STREAM_HPP_
+
+#include "../id/pid.hpp"
+#include "parse_listener.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// event_sink
+	//
+
+	/**
+	 * Receives the final output of a parser as stream of events. In contrast to
+	 * parse_listener events passed to an event_sink are never revoked.
+	 *
+	 * Nodes without children are reported via token, any other node is reported
+	 * via enter, followed by the events of its children and exit.
+	 *
+	 * @see event_stream
+	 */
+	class event_sink
+	{
+	public:
+		virtual ~event_sink(){}
+
+		virtual void enter(const pid &id, long start) = 0;
+
+		virtual void exit(const pid &id, long start, long end) = 0;
+
+		virtual void token(const pid &id, long start, long end) = 0;
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// event_stream
+	//
+
+	/**
+	 * Passes the output of a parser to an event_sink without building any tree. Events
+	 * produced within speculative branches (alternatives of a fork, iterations of a loop)
+	 * are buffered until the parser commits them and dropped if the branch fails. Thus
+	 * memory is bounded by the uncommitted part of the output and the depth of the tree.
+	 *
+	 * Use with parser_context::build_tree set to false for constant-memory output.
+	 *
+	 * @see event_sink
+	 * @see parse_listener::commit(std::size_t)
+	 */
+	class event_stream : public parse_listener
+	{
+	private:
+		struct event
+		{
+			bool enter;
+			pid id;
+			long start, end;
+
+			/**
+			 * index of the node in preorder
+			 */
+			std::size_t node;
+		};
+
+		struct open_node
+		{
+			pid id;
+			long start;
+			std::size_t node;
+		};
+
+		event_sink &sink;
+
+		/**
+		 * uncommitted events
+		 */
+		std::deque<event> buffer;
+
+		std::vector<open_node> open;
+
+		/**
+		 * number of nodes entered so far
+		 */
+		std::size_t node_ct = 0;
+
+		/**
+		 * Passes buffered events of the first mark nodes to the sink
+		 */
+		void flush(std::size_t mark);
+	public:
+		event_stream(event_sink &sink): sink(sink){}
+
+		void enter(const pid &id, long start);
+
+		void exit(long end);
+
+		void rewind(std::size_t mark);
+
+		void commit(std::size_t mark);
+
+		/**
+		 * @return the number of events that are currently buffered
+		 */
+		std::size_t buffered() const { return buffer.size(); }
+	};
+}
+
+#endif /* OUTP_EVENT_STREAM_HPP_ */
@@ -0,0 +1,169 @@
+#include "flat_tree.hpp"
+
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////
+// flat_tree
+//
+
+constexpr dvl::flat_tree::index dvl::flat_tree::NONE;
+
+dvl::lnstruct*
+dvl::flat_tree::to_lnstruct()
+	const
+{
+	if(empty())
+		return nullptr;
+
+	std::vector<lnstruct*> nodes(size());
+
+	for(std::size_t i = 0; i < size(); i++)
+	{
+		nodes[i] = new lnstruct(ids[i], starts[i]);
+
+		// nodes without valid end keep the default
+		if(ends[i] >= starts[i])
+			nodes[i]->set_end(ends[i]);
+	}
+
+	for(std::size_t i = 0; i < size(); i++)
+	{
+		if(child[i] != NONE)
+			nodes[i]->get_child() = nodes[child[i]];
+
+		if(next[i] != NONE)
+			nodes[i]->get_next() = nodes[next[i]];
+	}
+
+	return nodes[0];
+}
+
+dvl::flat_tree
+dvl::flat_tree::from_lnstruct(const lnstruct *ln)
+{
+	flat_tree_builder b;
+	std::vector<lnstruct*> st;
+
+	lnstruct *cur = const_cast<lnstruct*>(ln);
+
+	while(cur != nullptr)
+	{
+		b.enter(cur->get_pid(), cur->get_start());
+
+		if(cur->get_child() != nullptr)
+		{
+			st.push_back(cur);
+			cur = cur->get_child();
+			continue;
+		}
+
+		b.exit(cur->get_end());
+
+		while(cur->get_next() == nullptr && !st.empty())
+		{
+			cur = st.back();
+			st.pop_back();
+
+			b.exit(cur->get_end());
+		}
+
+		cur = cur->get_next();
+	}
+
+	return b.release();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// flat_tree_builder
+//
+
+void
+dvl::flat_tree_builder::enter(const pid &id, long start)
+{
+	index i = tree.size();
+
+	tree.ids.push_back(id);
+	tree.starts.push_back(start);
+	tree.ends.push_back(start);
+	tree.child.push_back(flat_tree::NONE);
+	tree.next.push_back(flat_tree::NONE);
+
+	// link with parent or previous sibling
+	open_node &parent = open.back();
+	if(parent.last_child != flat_tree::NONE)
+		tree.next[parent.last_child] = i;
+	else if(parent.node != flat_tree::NONE)
+		tree.child[parent.node] = i;
+
+	parent.last_child = i;
+	open.push_back({i, flat_tree::NONE});
+}
+
+void
+dvl::flat_tree_builder::exit(long end)
+{
+	if(open.size() < 2)
+		return;
+
+	tree.ends[open.back().node] = end;
+	open.pop_back();
+}
+
+void
+dvl::flat_tree_builder::rewind(std::size_t mark)
+{
+	if(mark >= tree.size())
+		return;
+
+	tree.truncate(mark);
+
+	while(open.size() > 1 && open.back().node >= mark)
+		open.pop_back();
+
+	// only the children of the innermost open node may link to dropped nodes
+	open_node &top = open.back();
+	if(top.last_child == flat_tree::NONE || top.last_child < mark)
+		return;
+
+	index c;
+	if(top.node == flat_tree::NONE)
+		c = (mark > 0 ? 0 : flat_tree::NONE);
+	else if(tree.child[top.node] >= mark)
+	{
+		tree.child[top.node] = flat_tree::NONE;
+		c = flat_tree::NONE;
+	}
+	else
+		c = tree.child[top.node];
+
+	// find the last child that is kept
+	while(c != flat_tree::NONE && tree.next[c] != flat_tree::NONE && tree.next[c] < mark)
+		c = tree.next[c];
+
+	if(c != flat_tree::NONE)
+		tree.next[c] = flat_tree::NONE;
+
+	top.last_child = c;
+}
+
+void
+dvl::flat_tree_builder::reserve(std::size_t n)
+{
+	tree.ids.reserve(n);
+	tree.starts.reserve(n);
+	tree.ends.reserve(n);
+	tree.child.reserve(n);
+	tree.next.reserve(n);
+}
+
+dvl::flat_tree
+dvl::flat_tree_builder::release()
+{
+	flat_tree result = std::move(tree);
+
+	tree = flat_tree();
+	open.clear();
+	open.push_back({flat_tree::NONE, flat_tree::NONE});
+
+	return result;
+}
@@ -0,0 +1,261 @@
+#ifndef OUTP_FLAT_TREE_HPP_
+#define OUTP_FLAT_TREE_HPP_
+
+#include "../id/pid.hpp"
+#include "lnstruct.hpp"
+#include "parse_listener.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <iterator>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// flat_tree
+	//
+
+	/**
+	 * Alternative representation of the output of a parser. In contrast to lnstruct, which
+	 * allocates a separate object per node, the nodes of a flat_tree are stored in parallel
+	 * arrays (pid, start, end, first child and next sibling), indexed by the position
+	 * of the node in preorder. I.e. the parent of a node always precedes its children, which
+	 * again precede the following siblings of the parent.
+	 *
+	 * Thus a traversal of all nodes in preorder is a linear scan over the arrays. Links
+	 * between nodes are stored as indices, nonexisting links are represented by NONE.
+	 *
+	 * Like lnstruct a flat_tree may hold a list of root-nodes. The first root is always
+	 * stored at index 0, further roots are linked via the next-sibling of the previous root.
+	 *
+	 * @see flat_tree_builder
+	 * @see lnstruct
+	 */
+	class flat_tree
+	{
+		friend class flat_tree_builder;
+	public:
+		/**
+		 * Type of node-indices
+		 */
+		typedef uint32_t index;
+
+		/**
+		 * Index representing a missing link
+		 */
+		static constexpr index NONE = ~(index) 0;
+
+		/**
+		 * Forward-iterator over a node and its following siblings
+		 */
+		class sibling_iterator : public std::iterator<std::forward_iterator_tag, index>
+		{
+		private:
+			const flat_tree *t;
+			index i;
+		public:
+			sibling_iterator(const flat_tree *t, index i): t(t), i(i){}
+
+			index operator*() const { return i; }
+
+			sibling_iterator &operator++(){ i = t->next[i]; return *this; }
+			sibling_iterator operator++(int){ sibling_iterator tmp = *this; ++*this; return tmp; }
+
+			bool operator==(const sibling_iterator &o) const { return i == o.i; }
+			bool operator!=(const sibling_iterator &o) const { return i != o.i; }
+		};
+
+		/**
+		 * Range of siblings, usable in range-based for-loops
+		 */
+		struct sibling_range
+		{
+			sibling_iterator first, last;
+
+			sibling_iterator begin() const { return first; }
+			sibling_iterator end() const { return last; }
+		};
+	private:
+		std::vector<pid> ids;
+		std::vector<long> starts, ends;
+
+		/**
+		 * first child and next sibling of each node
+		 */
+		std::vector<index> child, next;
+
+		/**
+		 * Drops all nodes with an index >= n. Doesn't update links of the remaining nodes.
+		 */
+		void truncate(std::size_t n)
+		{
+			ids.resize(n);
+			starts.resize(n);
+			ends.resize(n);
+			child.resize(n);
+			next.resize(n);
+		}
+	public:
+		/**
+		 * @return the number of nodes in this tree
+		 */
+		std::size_t size() const { return ids.size(); }
+
+		bool empty() const { return ids.empty(); }
+
+		const pid &get_pid(index i) const { return ids[i]; }
+
+		long get_start(index i) const { return starts[i]; }
+
+		long get_end(index i) const { return ends[i]; }
+
+		/**
+		 * @return the index of the first child of node i or NONE
+		 */
+		index get_child(index i) const { return child[i]; }
+
+		/**
+		 * @return the index of the next sibling of node i or NONE
+		 */
+		index get_next(index i) const { return next[i]; }
+
+		/**
+		 * @return the index of the first root or NONE if the tree is empty
+		 */
+		index root() const { return empty() ? NONE : 0; }
+
+		/**
+		 * @return the list of roots of this tree
+		 */
+		sibling_range roots() const { return {sibling_iterator(this, root()), sibling_iterator(this, NONE)}; }
+
+		/**
+		 * @return the children of node i
+		 */
+		sibling_range children(index i) const { return {sibling_iterator(this, child[i]), sibling_iterator(this, NONE)}; }
+
+		/**
+		 * Traverses the subtree rooted at node i and all following siblings of i in preorder
+		 * without recursion. The visitor must provide <code>enter(const flat_tree&, index)</code>
+		 * and <code>exit(const flat_tree&, index)</code>, which are called before the children of
+		 * a node are visited and after all children were visited respectively.
+		 *
+		 * @param v the visitor
+		 * @param i the node to start at
+		 */
+		template<typename V>
+		void visit(V &v, index i = 0) const
+		{
+			if(i >= size())
+				return;
+
+			std::vector<index> st;
+
+			while(true)
+			{
+				v.enter(*this, i);
+
+				if(child[i] != NONE)
+				{
+					st.push_back(i);
+					i = child[i];
+					continue;
+				}
+
+				v.exit(*this, i);
+
+				while(next[i] == NONE)
+				{
+					if(st.empty())
+						return;
+
+					i = st.back();
+					st.pop_back();
+
+					v.exit(*this, i);
+				}
+
+				i = next[i];
+			}
+		}
+
+		/**
+		 * Converts this tree into a tree of lnstructs. The caller takes ownership
+		 * of the returned structure.
+		 *
+		 * @return the first root of the converted tree or nullptr if this tree is empty
+		 */
+		lnstruct *to_lnstruct() const;
+
+		/**
+		 * Converts a tree of lnstructs into a flat_tree
+		 *
+		 * @param ln the first root of the tree (may be nullptr)
+		 * @return the converted tree
+		 */
+		static flat_tree from_lnstruct(const lnstruct *ln);
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// flat_tree_builder
+	//
+
+	/**
+	 * Builds a flat_tree from the events produced by a parser. Nodes are appended in
+	 * preorder, rewinding truncates the arrays.
+	 *
+	 * @see flat_tree
+	 * @see parse_listener
+	 * @see parser_context::listeners
+	 */
+	class flat_tree_builder : public parse_listener
+	{
+	private:
+		typedef flat_tree::index index;
+
+		/**
+		 * A node that wasn't completed yet together with its last child
+		 */
+		struct open_node
+		{
+			index node;
+			index last_child;
+		};
+
+		flat_tree tree;
+
+		/**
+		 * Stack of open nodes. The bottom-most element is a placeholder for the list of roots.
+		 */
+		std::vector<open_node> open;
+	public:
+		flat_tree_builder():
+			open{{flat_tree::NONE, flat_tree::NONE}}
+		{}
+
+		void enter(const pid &id, long start);
+
+		void exit(long end);
+
+		void rewind(std::size_t mark);
+
+		/**
+		 * Reserves space for n nodes
+		 */
+		void reserve(std::size_t n);
+
+		/**
+		 * @return the tree built so far
+		 */
+		const flat_tree &get() const { return tree; }
+
+		/**
+		 * Moves the tree out of this builder and resets the builder
+		 *
+		 * @return the tree built so far
+		 */
+		flat_tree release();
+	};
+}
+
+#endif /* OUTP_FLAT_TREE_HPP_ */
@@ -1,7 +1,9 @@
 #include "lnstruct.hpp"
+#include "structure_writer.hpp"
 
 #include <queue>
 #include <set>
+#include <sstream>
 #include <stack>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -135,3 +137,18 @@ dvl::lnstruct::is_tree()
 
 	return true;
 }
+
+std::wstring
+dvl::lnstruct::structure(pid_table &pt, std::wstring indent)
+	const
+{
+	std::wostringstream str;
+
+	{
+		structure_writer w(str, pt);
+		w.set_prefix(indent);
+		w.write(this);
+	}
+
+	return str.str();
+}
@@ -29,7 +29,8 @@ namespace dvl
 		long start;
 
 		/**
-		 * End-offset of the structure in the input-stream (inclusive)
+		 * End-offset of the structure in the input-stream (exclusive). The text of the
+		 * structure is the range [start, end) of the input.
 		 */
 		long end;
 
@@ -45,9 +46,9 @@ namespace dvl
 	public:
 		/**
 		 * Constructs a new lnstruct with the specified pid and start-offset.
-		 * End and associated lnstructs will be set to default-values (0/nullptr)
+		 * The end will be set to start (empty structure), associated lnstructs to nullptr
 		 */
-		lnstruct(pid id, long start):start(start), end(0l), id(id),
+		lnstruct(pid id, long start):start(start), end(start), id(id),
 										next(nullptr), child(nullptr){}
 		virtual ~lnstruct();
 
@@ -81,6 +82,12 @@ namespace dvl
 		 */
 		long get_end() const {return end;}
 
+		/**
+		 * Accessor for the pid of the routine that produced this lnstruct
+		 *
+		 * @see id
+		 */
+		const pid &get_pid() const {return id;}
 
 		/**
 		 * Accessor for the lnstruct following this structure
@@ -101,24 +108,9 @@ namespace dvl
 		 * string in an indentation-based tree-view.
 		 *
 		 * @param indent the indent used for this structure (child-structure will receive indent + "\t")
+		 * @see structure_writer
 		 */
-		std::wstring structure(pid_table &pt, std::wstring indent=L"") const
-		{
-			std::wstring result = L"";
-			result.append(indent);
-			result.append(pt.to_string(id, true));
-			result.append(L" start=").append(std::to_wstring(start));
-			result.append(L" end=").append(std::to_wstring(end));
-			result.append(L"\n");
-
-			if(child != nullptr)
-				result.append(child->structure(pt, indent + L"\t"));
-
-			if(next != nullptr)
-				result.append(next->structure(pt, indent));
-
-			return result;
-		}
+		std::wstring structure(pid_table &pt, std::wstring indent=L"") const;
 
 		/**
 		 * Counts the total number of lnstructs that are on the same level with
@@ -134,6 +126,7 @@ namespace dvl
 		 * that has this node as root.
 		 *
 		 * @return number of nodes in the subtree that has this routine as root
+		 * @see stats_listener for statistics maintained while parsing
 		 */
 		int total_count() const;
 
@@ -0,0 +1,70 @@
+#ifndef OUTP_PARSE_LISTENER_HPP_
+#define OUTP_PARSE_LISTENER_HPP_
+
+#include "../id/pid.hpp"
+
+#include <cstddef>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// parse_listener
+	//
+
+	/**
+	 * Receives the output of a parser as a sequence of events instead of a tree of
+	 * lnstructs. Nodes are reported in preorder: enter is called once a routine produced
+	 * its output, followed by the events of all of its children and a matching call
+	 * to exit once the routine completed.
+	 *
+	 * Events produced by routines that fail later on are revoked by rewind. The parser
+	 * counts the calls to enter, rewind(mark) reverts the listener to the state after
+	 * exactly mark calls to enter, i.e. all nodes entered afterwards must be dropped. Nodes
+	 * that were entered before and are still open remain open. Nodes reported via commit
+	 * won't be revoked anymore.
+	 *
+	 * Listeners are registered via parser_context::listeners.
+	 *
+	 * @see parser_context
+	 * @see parser
+	 */
+	class parse_listener
+	{
+	public:
+		virtual ~parse_listener(){}
+
+		/**
+		 * Called when a new node is opened
+		 *
+		 * @param id the pid of the node
+		 * @param start the offset of the node in the input
+		 */
+		virtual void enter(const pid &id, long start) = 0;
+
+		/**
+		 * Called when the most recently opened node, which is still open, is completed
+		 *
+		 * @param end the offset of the end of the node in the input (exclusive)
+		 */
+		virtual void exit(long end) = 0;
+
+		/**
+		 * Drops all nodes entered after the first mark nodes
+		 *
+		 * @param mark the number of nodes to keep
+		 */
+		virtual void rewind(std::size_t mark) = 0;
+
+		/**
+		 * Called once the first mark nodes can't be revoked anymore. I.e. any following
+		 * call to rewind will keep at least mark nodes. The parser reports this after
+		 * an enclosing fork or loop accepted the output of a child and once parsing
+		 * completed successfully.
+		 *
+		 * @param mark the number of nodes that are final
+		 */
+		virtual void commit(std::size_t /*mark*/){}
+	};
+}
+
+#endif /* OUTP_PARSE_LISTENER_HPP_ */
@@ -0,0 +1,91 @@
+#include "pid_index.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// pid_index
+//
+
+const std::vector<dvl::pid_index::entry> dvl::pid_index::EMPTY_LIST;
+
+void
+dvl::pid_index::list::prepare()
+	const
+{
+	max_end.resize(entries.size());
+
+	for(; valid < entries.size(); valid++)
+		max_end[valid] = valid == 0 ? entries[0].end : std::max(max_end[valid - 1], entries[valid].end);
+}
+
+void
+dvl::pid_index::enter(const pid &id, long start)
+{
+	list &l = lists[id];
+	l.id = id;
+
+	open.push_back({&l, l.entries.size()});
+	l.entries.push_back({start, start, nodes.size()});
+	nodes.push_back(&l);
+}
+
+void
+dvl::pid_index::exit(long end)
+{
+	if(open.empty())
+		return;
+
+	list *l = open.back().first;
+	std::size_t i = open.back().second;
+	open.pop_back();
+
+	l->entries[i].end = end;
+	l->valid = std::min(l->valid, i);
+}
+
+void
+dvl::pid_index::rewind(std::size_t mark)
+{
+	// nodes of each list are in preorder as well, thus dropped nodes are at the end
+	while(nodes.size() > mark)
+	{
+		list *l = nodes.back();
+		nodes.pop_back();
+
+		l->entries.pop_back();
+		l->valid = std::min(l->valid, l->entries.size());
+	}
+
+	while(!open.empty() && open.back().first->entries.size() <= open.back().second)
+		open.pop_back();
+}
+
+std::vector<dvl::pid>
+dvl::pid_index::pids()
+	const
+{
+	std::vector<pid> result;
+
+	for(auto &p : lists)
+		if(!p.second.entries.empty())
+			result.push_back(p.second.id);
+
+	return result;
+}
+
+dvl::pid_index
+dvl::pid_index::build(const flat_tree &t)
+{
+	struct visitor
+	{
+		pid_index &idx;
+
+		void enter(const flat_tree &t, flat_tree::index i){ idx.enter(t.get_pid(i), t.get_start(i)); }
+
+		void exit(const flat_tree &t, flat_tree::index i){ idx.exit(t.get_end(i)); }
+	};
+
+	pid_index idx;
+	visitor v{idx};
+	t.visit(v);
+
+	return idx;
+}
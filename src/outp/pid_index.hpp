@@ -0,0 +1,183 @@
+#ifndef OUTP_PID_INDEX_HPP_
+#define OUTP_PID_INDEX_HPP_
+
+#include "../id/pid.hpp"
+#include "parse_listener.hpp"
+#include "flat_tree.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// pid_index
+	//
+
+	/**
+	 * Index of the nodes produced by a parser by pid. The index is built as side effect of
+	 * parsing by registering it as listener in parser_context::listeners and keeps for each
+	 * pid the nodes in preorder, which is sorted by start. Thus lookups of all nodes of
+	 * a pid and range-queries don't require traversing the tree.
+	 *
+	 * Each node is identified by its position in preorder, which equals its index in a
+	 * flat_tree built from the same parse.
+	 *
+	 * @see parse_listener
+	 * @see flat_tree
+	 */
+	class pid_index : public parse_listener
+	{
+	public:
+		struct entry
+		{
+			long start, end;
+
+			/**
+			 * index of the node in preorder
+			 */
+			std::size_t node;
+		};
+	private:
+		struct list
+		{
+			pid id;
+
+			std::vector<entry> entries;
+
+			/**
+			 * max_end[i] is the maximum end of entries[0..i]. Only the first valid
+			 * elements are up to date.
+			 */
+			mutable std::vector<long> max_end;
+			mutable std::size_t valid = 0;
+
+			/**
+			 * updates max_end
+			 */
+			void prepare() const;
+		};
+
+		std::unordered_map<uint64_t, list> lists;
+
+		/**
+		 * list of each node in preorder
+		 */
+		std::vector<list*> nodes;
+
+		/**
+		 * open nodes as list and position within the list
+		 */
+		std::vector<std::pair<list*, std::size_t>> open;
+
+		static const std::vector<entry> EMPTY_LIST;
+
+		const list *find(const pid &id) const
+		{
+			auto it = lists.find(id);
+			return it == lists.end() ? nullptr : &it->second;
+		}
+	public:
+		pid_index() = default;
+
+		// nodes and open refer to the elements of lists
+		pid_index(const pid_index&) = delete;
+		pid_index(pid_index&&) = default;
+
+		void enter(const pid &id, long start);
+
+		void exit(long end);
+
+		void rewind(std::size_t mark);
+
+		/**
+		 * Builds the index of an existing tree
+		 */
+		static pid_index build(const flat_tree &t);
+
+		/**
+		 * @return the total number of indexed nodes
+		 */
+		std::size_t size() const { return nodes.size(); }
+
+		/**
+		 * @return the number of nodes with the specified pid
+		 */
+		std::size_t count(const pid &id) const
+		{
+			const list *l = find(id);
+			return l == nullptr ? 0 : l->entries.size();
+		}
+
+		/**
+		 * @return all nodes with the specified pid sorted by start
+		 */
+		const std::vector<entry> &get(const pid &id) const
+		{
+			const list *l = find(id);
+			return l == nullptr ? EMPTY_LIST : l->entries;
+		}
+
+		/**
+		 * @return all pids with at least one node
+		 */
+		std::vector<pid> pids() const;
+
+		/**
+		 * Calls f for each node with the specified pid that overlaps [a, b), i.e. each node
+		 * with start < b and end > a, in preorder. Empty nodes are reported if a <= start < b.
+		 * Candidates are located via binary search.
+		 *
+		 * @param id the pid of the nodes
+		 * @param a start of the range
+		 * @param b end of the range (exclusive)
+		 * @param f functor providing <code>operator()(const entry&)</code>
+		 */
+		template<typename F>
+		void overlapping(const pid &id, long a, long b, F f) const
+		{
+			const list *l = find(id);
+			if(l == nullptr)
+				return;
+
+			l->prepare();
+
+			const std::vector<entry> &e = l->entries;
+
+			// nodes starting at or after b can't overlap
+			std::size_t hi = std::lower_bound(e.begin(), e.end(), b,
+					[](const entry &x, long v){ return x.start < v; }) - e.begin();
+
+			// no node before lo ends after a
+			std::size_t lo = std::upper_bound(l->max_end.begin(), l->max_end.begin() + hi, a)
+					- l->max_end.begin();
+
+			// empty nodes starting at a end at a, but are reported as well
+			if(lo > 0 && lo <= hi)
+				lo = std::lower_bound(e.begin(), e.begin() + lo, a,
+						[](const entry &x, long v){ return x.start < v; }) - e.begin();
+
+			for(std::size_t i = lo; i < hi; i++)
+				if(e[i].end > a || (e[i].end == e[i].start && e[i].start >= a))
+					f(e[i]);
+		}
+
+		/**
+		 * Calls f for each pid of the given group and the nodes with that pid
+		 *
+		 * @param group the group of the pids
+		 * @param f functor providing <code>operator()(const pid&, const std::vector<entry>&)</code>
+		 */
+		template<typename F>
+		void for_each_in_group(uint32_t group, F f) const
+		{
+			for(auto &p : lists)
+				if(p.second.id.get_group() == group && !p.second.entries.empty())
+					f(p.second.id, p.second.entries);
+		}
+	};
+}
+
+#endif /* OUTP_PID_INDEX_HPP_ */
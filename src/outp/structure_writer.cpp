@@ -0,0 +1,256 @@
+#include "structure_writer.hpp"
+#include "../util/escape.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+// structure_writer
+//
+
+dvl::structure_writer::structure_writer(std::wostream &out, pid_table &pt, format fmt,
+		std::size_t buffer_size):
+	out(out),
+	pt(pt),
+	fmt(fmt),
+	buffer(buffer_size > 0 ? buffer_size : 1)
+{}
+
+dvl::structure_writer::~structure_writer()
+{
+	flush();
+}
+
+void
+dvl::structure_writer::flush()
+{
+	out.write(buffer.data(), buffered);
+	buffered = 0;
+}
+
+void
+dvl::structure_writer::put_number(long v)
+{
+	wchar_t tmp[24];
+	int n = 0;
+
+	unsigned long u = v < 0 ? -(unsigned long) v : v;
+
+	do{
+		tmp[n++] = L'0' + u % 10;
+		u /= 10;
+	}while(u);
+
+	if(v < 0)
+		put(L'-');
+
+	while(n > 0)
+		put(tmp[--n]);
+}
+
+void
+dvl::structure_writer::put_escaped(const std::wstring &str)
+{
+	if(fmt == format::JSON)
+	{
+		escape_json(str, [this](wchar_t c){ put(c); });
+		return;
+	}
+
+	for(wchar_t c : str)
+	{
+		if(fmt == format::XML)
+		{
+			switch(c)
+			{
+			case L'&': put(L"&amp;"); break;
+			case L'<': put(L"&lt;"); break;
+			case L'>': put(L"&gt;"); break;
+			case L'"': put(L"&quot;"); break;
+			default: put(c);
+			}
+		}
+		else
+			put(c);
+	}
+}
+
+const std::wstring&
+dvl::structure_writer::name_of(const pid &id)
+{
+	auto it = names.find(id);
+
+	if(it == names.end())
+		it = names.emplace(id, pt.to_string(id, true)).first;
+
+	return it->second;
+}
+
+void
+dvl::structure_writer::begin_document()
+{
+	depth = 0;
+	separate = false;
+
+	switch(fmt)
+	{
+	case format::JSON:
+		put(L'[');
+		break;
+	case format::XML:
+		// only the root is qualified, nodes are local elements of the schema
+		put(L"<?xml version=\"1.0\"?>\n<tns:tree xmlns:tns=\"http://www.example.org/parser_struct/\">\n");
+		break;
+	default:
+		break;
+	}
+}
+
+void
+dvl::structure_writer::end_document()
+{
+	switch(fmt)
+	{
+	case format::JSON:
+		put(L"]\n");
+		break;
+	case format::XML:
+		put(L"</tns:tree>\n");
+		break;
+	default:
+		break;
+	}
+}
+
+void
+dvl::structure_writer::begin_node(const pid &id, long start, long end, bool children)
+{
+	switch(fmt)
+	{
+	case format::TEXT:
+		put(prefix);
+		for(std::size_t i = 0; i < depth; i++)
+			put(L'\t');
+
+		put(name_of(id));
+		put(L" start=");
+		put_number(start);
+		put(L" end=");
+		put_number(end);
+		put(L'\n');
+		break;
+	case format::JSON:
+		if(separate)
+			put(L',');
+
+		put(L"{\"pid\":\"");
+		put_escaped(name_of(id));
+		put(L"\",\"start\":");
+		put_number(start);
+		put(L",\"end\":");
+		put_number(end);
+
+		if(children)
+			put(L",\"children\":[");
+
+		separate = false;
+		break;
+	case format::XML:
+		for(std::size_t i = 0; i <= depth; i++)
+			put(L'\t');
+
+		put(L"<node pid=\"");
+		put_escaped(name_of(id));
+		put(L"\" start=\"");
+		put_number(start);
+		put(L"\" end=\"");
+		put_number(end);
+		put(children ? L"\">\n" : L"\"/>\n");
+		break;
+	}
+
+	if(children)
+		depth++;
+}
+
+void
+dvl::structure_writer::end_node(bool children)
+{
+	if(children)
+		depth--;
+
+	switch(fmt)
+	{
+	case format::JSON:
+		put(children ? L"]}" : L"}");
+		separate = true;
+		break;
+	case format::XML:
+		if(!children)
+			break;
+
+		for(std::size_t i = 0; i <= depth; i++)
+			put(L'\t');
+
+		put(L"</node>\n");
+		break;
+	default:
+		break;
+	}
+}
+
+void
+dvl::structure_writer::write(const lnstruct *ln)
+{
+	begin_document();
+
+	std::vector<lnstruct*> st;
+	lnstruct *cur = const_cast<lnstruct*>(ln);
+
+	while(cur != nullptr)
+	{
+		bool children = cur->get_child() != nullptr;
+		begin_node(cur->get_pid(), cur->get_start(), cur->get_end(), children);
+
+		if(children)
+		{
+			st.push_back(cur);
+			cur = cur->get_child();
+			continue;
+		}
+
+		end_node(false);
+
+		while(cur->get_next() == nullptr && !st.empty())
+		{
+			cur = st.back();
+			st.pop_back();
+
+			end_node(true);
+		}
+
+		cur = cur->get_next();
+	}
+
+	end_document();
+}
+
+void
+dvl::structure_writer::write(const flat_tree &t)
+{
+	struct visitor
+	{
+		structure_writer &w;
+
+		void enter(const flat_tree &t, flat_tree::index i)
+		{
+			w.begin_node(t.get_pid(i), t.get_start(i), t.get_end(i), t.get_child(i) != flat_tree::NONE);
+		}
+
+		void exit(const flat_tree &t, flat_tree::index i)
+		{
+			w.end_node(t.get_child(i) != flat_tree::NONE);
+		}
+	} v{*this};
+
+	begin_document();
+	t.visit(v);
+	end_document();
+}
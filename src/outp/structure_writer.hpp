@@ -0,0 +1,145 @@
+#ifndef OUTP_STRUCTURE_WRITER_HPP_
+#define OUTP_STRUCTURE_WRITER_HPP_
+
+#include "../id/pid.hpp"
+#include "lnstruct.hpp"
+#include "flat_tree.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// structure_writer
+	//
+
+	/**
+	 * Writes a human-readable dump of a parse-tree to a stream. Trees are traversed without
+	 * recursion and the output is passed to the stream through a fixed-size buffer, thus
+	 * memory is bounded by the size of the buffer, the depth of the tree and the number of
+	 * distinct pids.
+	 *
+	 * Supported formats are
+	 * <ul>
+	 * 	<li>TEXT: the indentation-based tree-view produced by lnstruct::structure</li>
+	 * 	<li>JSON: an array of roots, each node as object with pid, start, end and
+	 * 		children (if any)</li>
+	 * 	<li>XML: a tree-element containing the nodes as nested node-elements as specified in
+	 * 		xml/parser_struct.xsd</li>
+	 * </ul>
+	 *
+	 * Each call to write produces a complete document.
+	 *
+	 * @see lnstruct::structure
+	 */
+	class structure_writer
+	{
+	public:
+		enum class format
+		{
+			TEXT,
+			JSON,
+			XML
+		};
+
+		static const std::size_t DEFAULT_BUFFER_SIZE = 4096;
+	private:
+		std::wostream &out;
+		pid_table &pt;
+
+		format fmt;
+
+		std::vector<wchar_t> buffer;
+		std::size_t buffered = 0;
+
+		/**
+		 * prefix of each line in TEXT-format
+		 */
+		std::wstring prefix;
+
+		/**
+		 * cached names of pids
+		 */
+		std::unordered_map<uint64_t, std::wstring> names;
+
+		std::size_t depth = 0;
+
+		/**
+		 * true if the next node in JSON-format must be preceeded by a separator
+		 */
+		bool separate = false;
+
+		void put(wchar_t c)
+		{
+			if(buffered == buffer.size())
+				flush();
+
+			buffer[buffered++] = c;
+		}
+
+		void put(const wchar_t *str)
+		{
+			while(*str)
+				put(*str++);
+		}
+
+		void put(const std::wstring &str)
+		{
+			for(wchar_t c : str)
+				put(c);
+		}
+
+		void put_number(long v);
+
+		/**
+		 * writes str escaped according to the format
+		 */
+		void put_escaped(const std::wstring &str);
+
+		const std::wstring &name_of(const pid &id);
+
+		void begin_document();
+
+		void end_document();
+
+		void begin_node(const pid &id, long start, long end, bool children);
+
+		void end_node(bool children);
+	public:
+		/**
+		 * @param out the stream to write to
+		 * @param pt table used to resolve the names of pids
+		 * @param fmt the format of the output
+		 * @param buffer_size the number of characters buffered before writing to out
+		 */
+		structure_writer(std::wostream &out, pid_table &pt, format fmt = format::TEXT,
+				std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+		~structure_writer();
+
+		/**
+		 * Sets a prefix for each line of the output in TEXT-format
+		 */
+		void set_prefix(const std::wstring &prefix){ this->prefix = prefix; }
+
+		/**
+		 * Writes ln, its subtree and all following siblings of ln
+		 */
+		void write(const lnstruct *ln);
+
+		/**
+		 * Writes all nodes of the given tree
+		 */
+		void write(const flat_tree &t);
+
+		/**
+		 * Passes all buffered output to the stream
+		 */
+		void flush();
+	};
+}
+
+#endif /* OUTP_STRUCTURE_WRITER_HPP_ */
@@ -0,0 +1,141 @@
+#ifndef OUTP_TEXT_VIEW_HPP_
+#define OUTP_TEXT_VIEW_HPP_
+
+#include "../id/pid.hpp"
+#include "lnstruct.hpp"
+#include "flat_tree.hpp"
+
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// text slices
+	//
+
+	/**
+	 * Non-owning view of the text of a node. Views refer to the buffered input of the parser
+	 * and remain valid as long as that buffer isn't modified or destroyed.
+	 *
+	 * @see parser_context::input()
+	 */
+	typedef boost::wstring_view text_view;
+
+	/**
+	 * Provides the text in the range [start, end) of the input. The range is clamped to the
+	 * bounds of the input.
+	 *
+	 * @param in the input of the parser
+	 * @param start the start of the range
+	 * @param end the end of the range (exclusive)
+	 * @return a view of the text in the range
+	 */
+	inline text_view text_of(const std::wstring &in, long start, long end)
+	{
+		long size = in.size();
+
+		start = start < 0 ? 0 : (start > size ? size : start);
+		end = end < start ? start : (end > size ? size : end);
+
+		return text_view(in.data() + start, end - start);
+	}
+
+	/**
+	 * @return the text of ln within the input
+	 */
+	inline text_view text_of(const std::wstring &in, const lnstruct *ln)
+	{
+		return text_of(in, ln->get_start(), ln->get_end());
+	}
+
+	/**
+	 * @return the text of node i of t within the input
+	 */
+	inline text_view text_of(const std::wstring &in, const flat_tree &t, flat_tree::index i)
+	{
+		return text_of(in, t.get_start(i), t.get_end(i));
+	}
+
+	/**
+	 * Calls f with the index and the text of each node of t with the specified pid in preorder.
+	 * Doesn't allocate any memory.
+	 *
+	 * @param in the input of the parser
+	 * @param t the tree to search
+	 * @param id the pid of the nodes
+	 * @param f functor providing <code>operator()(flat_tree::index, text_view)</code>
+	 */
+	template<typename F>
+	void for_each_text(const std::wstring &in, const flat_tree &t, const pid &id, F f)
+	{
+		for(flat_tree::index i = 0; i < t.size(); i++)
+			if(t.get_pid(i) == id)
+				f(i, text_of(in, t, i));
+	}
+
+	/**
+	 * Calls f with each lnstruct with the specified pid and its text in preorder. Searches
+	 * ln, its subtree and all following siblings.
+	 *
+	 * Unlike the overload for flat_tree this one allocates: lnstructs don't link to their
+	 * parent, so the traversal keeps the path to the current node on a heap-allocated stack,
+	 * bounded by the depth of the tree. Use flat_tree if extraction must be allocation-free.
+	 *
+	 * @param in the input of the parser
+	 * @param ln the first node to search
+	 * @param id the pid of the nodes
+	 * @param f functor providing <code>operator()(const lnstruct*, text_view)</code>
+	 */
+	template<typename F>
+	void for_each_text(const std::wstring &in, const lnstruct *ln, const pid &id, F f)
+	{
+		std::vector<lnstruct*> st;
+		lnstruct *cur = const_cast<lnstruct*>(ln);
+
+		while(cur != nullptr || !st.empty())
+		{
+			if(cur == nullptr)
+			{
+				cur = st.back()->get_next();
+				st.pop_back();
+				continue;
+			}
+
+			if(cur->get_pid() == id)
+				f((const lnstruct*) cur, text_of(in, cur));
+
+			st.push_back(cur);
+			cur = cur->get_child();
+		}
+	}
+
+	/**
+	 * Appends the text of all nodes with the specified pid to out in preorder. Reusing out
+	 * for multiple extractions avoids any allocation once its capacity suffices.
+	 *
+	 * @param in the input of the parser
+	 * @param t the tree to search
+	 * @param id the pid of the nodes
+	 * @param out the vector to append to
+	 */
+	inline void extract_text(const std::wstring &in, const flat_tree &t, const pid &id,
+			std::vector<text_view> &out)
+	{
+		for_each_text(in, t, id, [&out](flat_tree::index, text_view v){ out.push_back(v); });
+	}
+
+	/**
+	 * Allocates a traversal stack, see for_each_text(const std::wstring&, const lnstruct*, const pid&, F).
+	 *
+	 * @see extract_text(const std::wstring&, const flat_tree&, const pid&, std::vector<text_view>&)
+	 */
+	inline void extract_text(const std::wstring &in, const lnstruct *ln, const pid &id,
+			std::vector<text_view> &out)
+	{
+		for_each_text(in, ln, id, [&out](const lnstruct*, text_view v){ out.push_back(v); });
+	}
+}
+
+#endif /* OUTP_TEXT_VIEW_HPP_ */
@@ -0,0 +1,86 @@
+#include "tree_stats.hpp"
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+// stats_listener
+//
+
+void
+dvl::stats_listener::enter(const pid &id, long start)
+{
+	open_node &parent = open.back();
+
+	if(start < parent.last)
+		violated = true;
+
+	std::size_t depth = std::max(log.empty() ? committed_depth : log.back().max_depth, open.size());
+	log.push_back({id.get_type(), depth, parent.last});
+
+	parent.last = start;
+	open.push_back({stats.nodes, start, start});
+
+	stats.nodes++;
+	stats.max_depth = depth;
+	stats.per_type[id.get_type()]++;
+}
+
+void
+dvl::stats_listener::exit(long end)
+{
+	if(open.size() < 2)
+	{
+		violated = true;
+		return;
+	}
+
+	open_node n = open.back();
+	open.pop_back();
+
+	if(end < n.start || end < n.last)
+		violated = true;
+
+	open.back().last = end;
+}
+
+void
+dvl::stats_listener::rewind(std::size_t mark)
+{
+	if(mark >= stats.nodes)
+		return;
+
+	// committed nodes can't be revoked
+	if(mark < committed)
+	{
+		violated = true;
+		mark = committed;
+	}
+
+	while(open.size() > 1 && open.back().node >= mark)
+		open.pop_back();
+
+	// restore the innermost remaining node to the state before the first revoked child
+	open.back().last = log[mark - committed].parent_last;
+
+	while(stats.nodes > mark)
+	{
+		stats.per_type[log.back().type]--;
+		stats.nodes--;
+
+		log.pop_back();
+	}
+
+	stats.max_depth = log.empty() ? committed_depth : log.back().max_depth;
+}
+
+void
+dvl::stats_listener::commit(std::size_t mark)
+{
+	mark = std::min(mark, stats.nodes);
+
+	for(; committed < mark; committed++)
+	{
+		committed_depth = log.front().max_depth;
+		log.pop_front();
+	}
+}
@@ -0,0 +1,143 @@
+#ifndef OUTP_TREE_STATS_HPP_
+#define OUTP_TREE_STATS_HPP_
+
+#include "../id/pid.hpp"
+#include "parse_listener.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// tree_stats
+	//
+
+	/**
+	 * Statistics of the output of a parser
+	 *
+	 * @see stats_listener
+	 */
+	struct tree_stats
+	{
+		/**
+		 * total number of nodes
+		 */
+		std::size_t nodes = 0;
+
+		/**
+		 * number of nodes on the longest path from a root to a leaf (0 for an empty tree)
+		 */
+		std::size_t max_depth = 0;
+
+		/**
+		 * number of nodes per type of pid
+		 */
+		std::size_t per_type[256] = {};
+
+		/**
+		 * true if all nodes were closed, no node ends before it starts and each node
+		 * lies within its parent and after its previous sibling
+		 */
+		bool well_formed = true;
+	};
+
+	////////////////////////////////////////////////////////////////////////////
+	// stats_listener
+	//
+
+	/**
+	 * Maintains tree_stats while parsing, thus no traversal of the result is required.
+	 * Revoked nodes are removed from the statistics on rewind. Only the part of the output
+	 * that wasn't committed yet is logged, thus memory is bounded by the uncommitted part
+	 * of the output.
+	 *
+	 * @see parse_listener
+	 * @see tree_stats
+	 */
+	class stats_listener : public parse_listener
+	{
+	private:
+		/**
+		 * log-entry of an uncommitted node
+		 */
+		struct logged
+		{
+			uint8_t type;
+
+			/**
+			 * maximum depth of the tree including this node
+			 */
+			std::size_t max_depth;
+
+			/**
+			 * the value of open_node::last of the parent before this node was entered
+			 */
+			long parent_last;
+		};
+
+		/**
+		 * node-index of the placeholder for the list of roots
+		 */
+		static const std::size_t ROOTS = ~(std::size_t) 0;
+
+		struct open_node
+		{
+			std::size_t node;
+			long start;
+
+			/**
+			 * position, after which the next child must start
+			 */
+			long last;
+		};
+
+		tree_stats stats;
+
+		std::deque<logged> log;
+
+		/**
+		 * number of nodes preceding the first log-entry
+		 */
+		std::size_t committed = 0;
+
+		/**
+		 * maximum depth up to the first log-entry
+		 */
+		std::size_t committed_depth = 0;
+
+		/**
+		 * The bottom-most element is a placeholder for the list of roots
+		 */
+		std::vector<open_node> open{{ROOTS, 0, 0}};
+
+		/**
+		 * Set once a node violated the structure. Violations aren't revoked by rewind,
+		 * since they indicate an error of the producer of the events.
+		 */
+		bool violated = false;
+	public:
+		void enter(const pid &id, long start);
+
+		void exit(long end);
+
+		void rewind(std::size_t mark);
+
+		void commit(std::size_t mark);
+
+		/**
+		 * @return the statistics of the output so far
+		 */
+		tree_stats get() const
+		{
+			tree_stats s = stats;
+			s.well_formed = !violated && open.size() == 1;
+
+			return s;
+		}
+	};
+}
+
+#endif /* OUTP_TREE_STATS_HPP_ */
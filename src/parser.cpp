@@ -1,4 +1,6 @@
 #include "parser.hpp"
+#include "syntax/inline_routine.hpp"
+#include "util/scan.hpp"
 
 #include <queue>
 #include <cstdlib>
@@ -15,6 +17,10 @@
  * solely serves to keep implementations of parser_routine from floating freely in the code.
  * It should be considered as a collection of utilities or a separate namespace
  *
+ * Routines producing output are templates over build. Instances with build = false are
+ * recognizers: they don't allocate any lnstruct and thus always yield a nullptr as result.
+ *
+ * @see dvl::parser_routine_factory::build_recognizer
  * @see dvl::parser_routine_factory
  */
 struct routine_factory_util
@@ -25,6 +31,7 @@ struct routine_factory_util
 
 	typedef dvl::parser_routine_factory::parser_routine base_routine;
 
+	template<bool build = true>
 	class parser_fork_routine : public base_routine
 	{
 	private:
@@ -34,6 +41,11 @@ struct routine_factory_util
 
 		dvl::lnstruct *base;
 		dvl::lnstruct *last_success;
+
+		bool started;
+
+		// last_success may be null, if the parser doesn't retain output
+		bool matched;
 	public:
 		parser_fork_routine(dvl::fork_routine* fr)
 			: base_routine(fr->get_pid())
@@ -42,6 +54,8 @@ struct routine_factory_util
 			this->fr = fr;
 			base = nullptr;
 			last_success = nullptr;
+			started = false;
+			matched = false;
 			f_iter = fr->forks().begin();
 		}
 
@@ -55,21 +69,27 @@ struct routine_factory_util
 		void place_child(dvl::lnstruct* l)
 			throw(dvl::parser_exception)
 		{
-			if(base == nullptr)
+			if(!started)
 				throw dvl::parser_exception(fr->get_pid(), dvl::parser_exception::lnstruct_premature_insertion());
 
-			if(last_success != nullptr)
+			if(matched)
 				throw dvl::parser_exception(fr->get_pid(), "Found multiple matching definitions");
 
 			last_success = l;
+			matched = true;
 		}
 
 		void run(dvl::routine_interface& ri)
 			throw(dvl::parser_exception)
 		{
 			// routine runs for the first time
-			if(base == nullptr)
-				base = new dvl::lnstruct(dvl::routine::get_pid(), ri.get_istream().tellg());
+			if(!started)
+			{
+				started = true;
+
+				if(build)
+					base = new dvl::lnstruct(dvl::routine::get_pid(), ri.get_istream().tellg());
+			}
 			else
 			{
 				// catch exception-status of last routine run (no need to handle)
@@ -83,10 +103,11 @@ struct routine_factory_util
 
 			if(f_iter == fr->forks().end())
 			{
-				if(last_success == nullptr)
+				if(!matched)
 					throw dvl::parser_exception(fr->get_pid(), "No matching definition found");
 
-				base->get_child() = last_success;
+				if(build)
+					base->get_child() = last_success;
 
 				return;
 			}
@@ -100,6 +121,7 @@ struct routine_factory_util
 		}
 	};
 
+	template<bool build = true>
 	class parser_empty_routine : public base_routine
 	{
 	private:
@@ -121,15 +143,19 @@ struct routine_factory_util
 		void run(dvl::routine_interface& ri)
 			throw(dvl::parser_exception)
 		{
-			ln = new dvl::lnstruct(dvl::EMPTY, ri.get_istream().tellg());
+			if(build)
+				ln = new dvl::lnstruct(dvl::EMPTY, ri.get_istream().tellg());
 		}
 	};
 
+	template<bool build = true>
 	class parser_loop_routine : public base_routine
 	{
 	private:
 		unsigned int run_ct = 0;
 
+		bool started = false;
+
 		dvl::loop_routine *r;
 
 		dvl::lnstruct *ln;
@@ -147,9 +173,22 @@ struct routine_factory_util
 		void place_child(dvl::lnstruct* c)
 			throw(dvl::parser_exception)
 		{
-			if(insert_pos == nullptr)
+			if(!started)
 				throw dvl::parser_exception(get_pid(), dvl::parser_exception::lnstruct_premature_insertion());
 
+			if(!build || c == nullptr)
+				return;
+
+			// place output of the iteration without helper
+			if(r->get_helper_policy() == dvl::output_policy::TRANSPARENT)
+			{
+				*insert_pos = c;
+				while(*insert_pos != nullptr)
+					insert_pos = &(*insert_pos)->get_next();
+
+				return;
+			}
+
 			//wrap ln into helper to keep next-slot free
 			dvl::lnstruct *helper = new dvl::lnstruct(dvl::LOOP_HELPER, c->get_start());
 			helper->set_end(c->get_end());
@@ -160,14 +199,27 @@ struct routine_factory_util
 			insert_pos = &helper->get_next();
 		}
 
+		bool wraps_children() const { return r->get_helper_policy() == dvl::output_policy::EMIT; }
+
+		bool may_fail() const
+		{
+			return r->get_min_iterations() == dvl::loop_routine::_INFINITY ||
+					run_ct < r->get_min_iterations();
+		}
+
 		void run(dvl::routine_interface& ri)
 			throw(dvl::parser_exception)
 		{
 			//initialize ln and insert_pos
-			if(ln == nullptr)
+			if(!started)
 			{
-				ln = new dvl::lnstruct(get_pid(), ri.get_istream().tellg());
-				insert_pos = &ln->get_child();
+				started = true;
+
+				if(build)
+				{
+					ln = new dvl::lnstruct(get_pid(), ri.get_istream().tellg());
+					insert_pos = &ln->get_child();
+				}
 			}
 
 			// check status of last child-run
@@ -198,12 +250,148 @@ struct routine_factory_util
 		}
 	};
 
+	template<bool build = true>
+	class parser_sequence_routine : public base_routine
+	{
+	private:
+		dvl::sequence_routine *r;
+
+		/**
+		 * index of the next element to run
+		 */
+		std::size_t i = 0;
+
+		bool started = false;
+
+		dvl::lnstruct *ln = nullptr;
+		dvl::lnstruct **insert_pos = nullptr;
+	public:
+		parser_sequence_routine(dvl::sequence_routine *r): base_routine(r->get_pid()),
+			r(r)
+		{}
+
+		dvl::lnstruct *get_result()
+		{
+			return ln;
+		}
+
+		void place_child(dvl::lnstruct *c)
+			throw(dvl::parser_exception)
+		{
+			if(!started)
+				throw dvl::parser_exception(get_pid(), dvl::parser_exception::lnstruct_premature_insertion());
+
+			if(!build)
+				return;
+
+			// the output of an element may be a chain
+			*insert_pos = c;
+			while(*insert_pos != nullptr)
+				insert_pos = &(*insert_pos)->get_next();
+		}
+
+		void run(dvl::routine_interface &ri)
+			throw(dvl::parser_exception)
+		{
+			if(!started)
+			{
+				started = true;
+
+				if(build)
+				{
+					ln = new dvl::lnstruct(get_pid(), ri.get_istream().tellg());
+					insert_pos = &ln->get_child();
+				}
+			}
+			else
+				// a failing element fails the sequence, the parser rewinds to its start
+				ri.check_child_exception();
+
+			std::vector<dvl::routine*> &e = r->elements();
+
+			if(i == e.size())
+				return;
+
+			// the last element is run without repetition
+			if(i + 1 < e.size())
+				base_routine::repeat(ri);
+
+			ri.run_as_child(e[i++]);
+		}
+	};
+
+	class parser_predicate_routine : public base_routine
+	{
+	private:
+		dvl::predicate_routine *r;
+
+		std::streampos start;
+
+		bool ran = false;
+	public:
+		parser_predicate_routine(dvl::predicate_routine *r): base_routine(r->get_pid()),
+			r(r)
+		{}
+
+		// predicates don't produce any output
+		dvl::lnstruct *get_result()
+		{
+			return nullptr;
+		}
+
+		bool recognizes_children() const { return true; }
+
+		void place_child(dvl::lnstruct *l)
+			throw(dvl::parser_exception)
+		{
+			if(!ran)
+				throw dvl::parser_exception(get_pid(), dvl::parser_exception::lnstruct_premature_insertion());
+
+			// output of the child isn't retained
+			delete l;
+		}
+
+		void run(dvl::routine_interface &ri)
+			throw(dvl::parser_exception)
+		{
+			if(!ran)
+			{
+				ran = true;
+				start = ri.get_istream().tellg();
+
+				base_routine::repeat(ri);
+				ri.run_as_child(r->get_child());
+
+				return;
+			}
+
+			bool matched = true;
+
+			try{
+				ri.check_child_exception();
+			}catch(const dvl::parser_exception &e)
+			{
+				matched = false;
+			}
+
+			if(matched == r->is_negated())
+				throw dvl::parser_exception(get_pid(), matched ? "Unexpected match of negative lookahead" :
+						"Lookahead didn't match");
+
+			// never consume input
+			ri.rewind(start);
+		}
+	};
+
+	template<bool build = true>
 	class parser_struct_routine : public base_routine
 	{
 	private:
 		dvl::struct_routine *r;
 
 		dvl::lnstruct *ln;
+
+		bool ran = false;
 	public:
 		parser_struct_routine(dvl::struct_routine *r): base_routine(r->get_pid()),
 			r(r), ln(nullptr)
@@ -214,19 +402,26 @@ struct routine_factory_util
 			return ln;
 		}
 
+		// runs only once
+		bool may_fail() const { return !ran; }
+
 		void place_child(dvl::lnstruct* l)
 			throw(dvl::parser_exception)
 		{
-			if(ln == nullptr)
+			if(!ran)
 				throw dvl::parser_exception(get_pid(), dvl::parser_exception::lnstruct_premature_insertion());
 
-			ln->get_child() = l;
+			if(build)
+				ln->get_child() = l;
 		}
 
 		void run(dvl::routine_interface &ri)
 			throw(dvl::parser_exception)
 		{
-			ln = new dvl::lnstruct(get_pid(), ri.get_istream().tellg());
+			ran = true;
+
+			if(build)
+				ln = new dvl::lnstruct(get_pid(), ri.get_istream().tellg());
 
 			// place routines to run
 			if(r->get_child() != nullptr)
@@ -237,6 +432,7 @@ struct routine_factory_util
 		}
 	};
 
+	template<bool build = true>
 	class parser_matcher_routine : public base_routine
 	{
 	private:
@@ -262,8 +458,6 @@ struct routine_factory_util
 		void run(dvl::routine_interface &ri)
 			throw(dvl::parser_exception)
 		{
-			ln = new dvl::lnstruct(get_pid(), ri.get_istream().tellg());
-
 			// compare input to predefined string
 			const wchar_t *str = s.c_str();
 			for(const wchar_t *c = str; c < str + s.length(); c++)
@@ -276,6 +470,14 @@ struct routine_factory_util
 				if((wint_t) *c != sc)
 					throw dvl::parser_exception(get_pid(), "Mismatch in string");
 			}
+
+			if(build)
+			{
+				long end = ri.get_istream().tellg();
+
+				ln = new dvl::lnstruct(get_pid(), end - s.length());
+				ln->set_end(end);
+			}
 		}
 	};
 
@@ -337,6 +539,7 @@ struct routine_factory_util
 		}
 	};
 
+	template<bool build = true>
 	class parser_charset_routine : public base_routine
 	{
 	private:
@@ -364,7 +567,7 @@ struct routine_factory_util
 		void run(dvl::routine_interface &ri)
 			throw(dvl::parser_exception)
 		{
-			ln = new dvl::lnstruct(get_pid(), ri.get_istream().tellg());
+			long start = ri.get_istream().tellg();
 
 			unsigned int ct = 0;
 			while(ct < r->get_max_repetitions() || r->get_max_repetitions() == dvl::charset_routine::_INFINITY)
@@ -379,7 +582,7 @@ struct routine_factory_util
 				else
 				{
 					// mismatch, reset to before mismatch
-					ri.get_istream().seekg(pos, std::ios::beg);
+					ri.rewind(pos);
 					break;
 				}
 			}
@@ -387,9 +590,142 @@ struct routine_factory_util
 			// check if output is in required repetition-range
 			if(ct < r->get_min_repetitions())
 				throw dvl::parser_exception(get_pid(), "No full match found");
+
+			if(build)
+			{
+				ln = new dvl::lnstruct(get_pid(), start);
+				ln->set_end(start + ct);
+			}
 		}
 	};
 
+	template<bool build = true>
+	class parser_regex_routine : public base_routine
+	{
+	private:
+		dvl::regex_routine *r;
+
+		dvl::lnstruct *ln;
+	public:
+		parser_regex_routine(dvl::regex_routine *r) :
+			base_routine(r->get_pid()),
+			r(r),
+			ln(nullptr)
+		{}
+
+		dvl::lnstruct *get_result()
+		{
+			return ln;
+		}
+
+		void place_child(dvl::lnstruct *)
+			throw(dvl::parser_exception)
+		{
+			throw dvl::parser_exception(get_pid(), dvl::parser_exception::lnstruct_invalid_insertion("parser_regex_routine"));
+		}
+
+		void run(dvl::routine_interface &ri)
+			throw(dvl::parser_exception)
+		{
+			dvl::input_cursor c = ri.get_cursor();
+			long len;
+
+			const dvl::lazy_dfa *dfa = r->get_dfa();
+
+			if(dfa != nullptr)
+				len = dfa->longest_match(ri.get_dfa_cache(*dfa), c.data(), c.end());
+			else
+			{
+				boost::wcmatch m;
+
+				if(boost::regex_search(c.data(), c.end(), m, r->get_reg(),
+						boost::match_continuous | boost::match_posix))
+					len = m.length();
+				else
+					len = -1;
+			}
+
+			if(len < 0)
+				throw dvl::parser_exception(get_pid(), "No match for regex");
+
+			long start = c.pos();
+			c.advance(len);
+			ri.commit(c);
+
+			if(build)
+			{
+				ln = new dvl::lnstruct(get_pid(), start);
+				ln->set_end(c.pos());
+			}
+		}
+	};
+
+	template<bool build = true>
+	class parser_delimited_routine : public base_routine
+	{
+	private:
+		dvl::delimited_routine *r;
+
+		dvl::lnstruct *ln;
+	public:
+		parser_delimited_routine(dvl::delimited_routine *r) :
+			base_routine(r->get_pid()),
+			r(r),
+			ln(nullptr)
+		{}
+
+		dvl::lnstruct *get_result()
+		{
+			return ln;
+		}
+
+		void place_child(dvl::lnstruct *)
+			throw(dvl::parser_exception)
+		{
+			throw dvl::parser_exception(get_pid(), dvl::parser_exception::lnstruct_invalid_insertion("parser_delimited_routine"));
+		}
+
+		void run(dvl::routine_interface &ri)
+			throw(dvl::parser_exception)
+		{
+			dvl::input_cursor c = ri.get_cursor();
+			const std::wstring &stops = r->get_stops();
+			const wchar_t *p = c.data(), *end = c.end();
+
+			// skip to the next character of interest until the terminator is found
+			while(true)
+			{
+				p = util::find_first_of(p, end, stops.data(), stops.size());
+
+				if(p == end)
+					throw dvl::parser_exception(get_pid(), "Reached EOF while scanning delimited content");
+				else if(*p == r->get_terminator())
+					break;
+				else if(r->is_fail(*p))
+					throw dvl::parser_exception(get_pid(), "Invalid character in delimited content");
+
+				// escape-character: skip the escaped character
+				if(++p == end)
+					throw dvl::parser_exception(get_pid(), "Reached EOF while scanning delimited content");
+				else if(r->is_fail(*p))
+					throw dvl::parser_exception(get_pid(), "Invalid character in delimited content");
+
+				++p;
+			}
+
+			long start = c.pos();
+			c.set(p);
+			ri.commit(c);
+
+			if(build)
+			{
+				ln = new dvl::lnstruct(get_pid(), start);
+				ln->set_end(c.pos());
+			}
+		}
+	};
+
+	template<bool build = true>
 	class parser_lambda_routine : public base_routine
 	{
 	private:
@@ -417,81 +753,221 @@ struct routine_factory_util
 			throw(dvl::parser_exception)
 		{
 			ln = f(ri);
+
+			// the output of the functor can't be suppressed
+			if(!build)
+			{
+				delete ln;
+				ln = nullptr;
+			}
 		}
 	};
+
+	//////////////////////////////////////////////////////////////////////////////
+	// constructors
+	//
+
+	template<typename P, typename R>
+	static base_routine *construct(dvl::routine *r)
+	{
+		return new P((R*) r);
+	}
+
+	template<bool build = true>
+	static base_routine *construct_empty(dvl::routine*)
+	{
+		return new parser_empty_routine<build>();
+	}
+
+	static base_routine *construct_inline(dvl::routine *r)
+	{
+		return ((dvl::inline_routine_base*) r)->instantiate();
+	}
+
+	static base_routine *construct_inline_recognizer(dvl::routine *r)
+	{
+		return ((dvl::inline_routine_base*) r)->instantiate_recognizer();
+	}
+
+	static base_routine *no_internal_routine(dvl::routine*)
+	{
+		throw dvl::parser_exception(dvl::PARSER, "No routines with the specified group available");
+	}
+
+	static dvl::parser_routine_factory::constructor resolve_internal(dvl::routine *r)
+	{
+		switch(r->get_pid().get_group())
+		{
+		case dvl::GROUP_INTERNAL:
+			switch(r->get_pid().get_element())
+			{
+			case 0:	//empty routine
+				return &construct_empty<>;
+			}
+			break;
+		case dvl::GROUP_DIAGNOSTIC:
+			switch(r->get_pid().get_element())
+			{
+			case 0:	// echo routine
+				return &construct<parser_echo_routine, dvl::echo_routine>;
+			case 1:
+				return &construct<parser_stack_routine, dvl::stack_trace_routine>;
+			}
+			break;
+		}
+
+		return &no_internal_routine;
+	}
+
+	static base_routine *construct_internal(dvl::routine *r)
+	{
+		return resolve_internal(r)(r);
+	}
 };
 
 dvl::parser_routine_factory::parser_routine_factory()
 {
-
+	constructors.fill(nullptr);
+	resolvers.fill(nullptr);
+	recognizers.fill(nullptr);
 }
 
 dvl::parser_routine_factory::parser_routine*
 dvl::parser_routine_factory::build_routine(routine* r)
 	throw(parser_exception)
 {
-	if(transformations.find(r->get_pid().get_type()) != transformations.end())
-		return transformations[r->get_pid().get_type()](r);
-	else
+	std::size_t i = r->get_index();
+
+	// routines numbered by another grammar_index fall back to the constructor of the type
+	constructor c = i < bound.size() && bound[i].r == r ? bound[i].c : constructors[r->get_pid().get_type()];
+
+	parser_routine *pr = c != nullptr ? c(r) : transform_routine(r);
+	pr->set_output_policy(r->get_output_policy());
+	pr->set_index(i);
+
+	return pr;
+}
+
+dvl::parser_routine_factory::parser_routine*
+dvl::parser_routine_factory::build_recognizer(routine* r)
+	throw(parser_exception)
+{
+	constructor c = recognizers[r->get_pid().get_type()];
+
+	if(c == nullptr)
+		return build_routine(r);
+
+	parser_routine *pr = c(r);
+	pr->set_output_policy(r->get_output_policy());
+	pr->set_index(r->get_index());
+
+	return pr;
+}
+
+dvl::parser_routine_factory::parser_routine*
+dvl::parser_routine_factory::transform_routine(routine *r)
+	throw(parser_exception)
+{
+	transform &t = transformations[r->get_pid().get_type()];
+
+	if(!t)
 		throw parser_exception(PARSER, "No generator for routine of specified type found");
+
+	return t(r);
 }
 
 void
 dvl::parser_routine_factory::register_transformation(uint8_t type, transform t)
 {
+	// bindings refer to the previous configuration
+	bound.clear();
+
 	transformations[type] = t;
+	constructors[type] = nullptr;
+	resolvers[type] = nullptr;
+	recognizers[type] = nullptr;
 }
 
 void
-dvl::parser_routine_factory::default_config(parser_routine_factory &f)
+dvl::parser_routine_factory::register_constructor(uint8_t type, constructor c)
 {
-	f.register_transformation(TYPE_FORK, [](routine* r)->routine_factory_util::parser_fork_routine*{
-		return new routine_factory_util::parser_fork_routine((fork_routine*) r);
-	});
+	// bindings refer to the previous configuration
+	bound.clear();
 
-	f.register_transformation(TYPE_EMPTY, [](routine*)->routine_factory_util::parser_empty_routine*{
-		return new routine_factory_util::parser_empty_routine();
-	});
+	constructors[type] = c;
+	transformations[type] = nullptr;
+	recognizers[type] = nullptr;
+}
 
-	f.register_transformation(TYPE_LOOP, [](routine* r)->routine_factory_util::parser_loop_routine*{
-		return new routine_factory_util::parser_loop_routine((loop_routine*) r);
-	});
+void
+dvl::parser_routine_factory::register_resolver(uint8_t type, resolver r)
+{
+	// bindings refer to the previous configuration
+	bound.clear();
 
-	f.register_transformation(TYPE_STRUCT, [](routine *r)->routine_factory_util::parser_struct_routine*{
-		return new routine_factory_util::parser_struct_routine((struct_routine*) r);
-	});
+	resolvers[type] = r;
+}
 
-	f.register_transformation(TYPE_STRING_MATCHER, [](routine *r)->routine_factory_util::parser_matcher_routine*{
-		return new routine_factory_util::parser_matcher_routine((string_matcher_routine*) r);
-	});
+void
+dvl::parser_routine_factory::register_recognizer(uint8_t type, constructor c)
+{
+	recognizers[type] = c;
+}
 
-	f.register_transformation(TYPE_CHARSET, [](routine *r)->routine_factory_util::parser_charset_routine*{
-		return new routine_factory_util::parser_charset_routine((charset_routine*) r);
-	});
+void
+dvl::parser_routine_factory::bind(const grammar_index &gi)
+{
+	bound.assign(gi.routine_count(), {nullptr, nullptr});
 
-	f.register_transformation(TYPE_INTERNAL, [](routine *r)->parser_routine_factory::parser_routine*{
-		switch(r->get_pid().get_group())
-		{
-		case GROUP_INTERNAL:
-			switch(r->get_pid().get_element())
-			{
-			case 0:	//empty routine
-				return new routine_factory_util::parser_empty_routine();
-			}
-			break;
-		case GROUP_DIAGNOSTIC:
-			switch(r->get_pid().get_element())
-			{
-			case 0:	// echo routine
-				return new routine_factory_util::parser_echo_routine((echo_routine*) r);
-			case 1:
-				return new routine_factory_util::parser_stack_routine((stack_trace_routine*) r);
-			}
-			break;
-		}
+	for(std::size_t i = 0; i < gi.routine_count(); i++)
+	{
+		routine *r = gi.get_routine(i);
+		uint8_t type = r->get_pid().get_type();
 
-		throw dvl::parser_exception(PARSER, "No routines with the specified group available");
-	});
+		bound[i].r = r;
+
+		// types registered via transformations aren't bound
+		if(resolvers[type] != nullptr && !transformations[type])
+			bound[i].c = resolvers[type](r);
+		else
+			bound[i].c = constructors[type];
+	}
+}
+
+void
+dvl::parser_routine_factory::default_config(parser_routine_factory &f)
+{
+	typedef routine_factory_util u;
+
+	f.register_constructor(TYPE_FORK, &u::construct<u::parser_fork_routine<>, fork_routine>);
+	f.register_constructor(TYPE_EMPTY, &u::construct_empty<>);
+	f.register_constructor(TYPE_LOOP, &u::construct<u::parser_loop_routine<>, loop_routine>);
+	f.register_constructor(TYPE_STRUCT, &u::construct<u::parser_struct_routine<>, struct_routine>);
+	f.register_constructor(TYPE_SEQUENCE, &u::construct<u::parser_sequence_routine<>, sequence_routine>);
+	f.register_constructor(TYPE_PREDICATE, &u::construct<u::parser_predicate_routine, predicate_routine>);
+	f.register_constructor(TYPE_STRING_MATCHER, &u::construct<u::parser_matcher_routine<>, string_matcher_routine>);
+	f.register_constructor(TYPE_CHARSET, &u::construct<u::parser_charset_routine<>, charset_routine>);
+	f.register_constructor(TYPE_REGEX, &u::construct<u::parser_regex_routine<>, regex_routine>);
+	f.register_constructor(TYPE_DELIMITED, &u::construct<u::parser_delimited_routine<>, delimited_routine>);
+	f.register_constructor(TYPE_LAMBDA, &u::construct<u::parser_lambda_routine<>, lambda_routine>);
+	f.register_constructor(TYPE_INLINE, &u::construct_inline);
+
+	// internal routines are resolved by group and element once per routine, if bound
+	f.register_constructor(TYPE_INTERNAL, &u::construct_internal);
+	f.register_resolver(TYPE_INTERNAL, &u::resolve_internal);
+
+	// routines without output (predicates, internal routines) are used as recognizers as well
+	f.register_recognizer(TYPE_FORK, &u::construct<u::parser_fork_routine<false>, fork_routine>);
+	f.register_recognizer(TYPE_EMPTY, &u::construct_empty<false>);
+	f.register_recognizer(TYPE_LOOP, &u::construct<u::parser_loop_routine<false>, loop_routine>);
+	f.register_recognizer(TYPE_STRUCT, &u::construct<u::parser_struct_routine<false>, struct_routine>);
+	f.register_recognizer(TYPE_SEQUENCE, &u::construct<u::parser_sequence_routine<false>, sequence_routine>);
+	f.register_recognizer(TYPE_STRING_MATCHER, &u::construct<u::parser_matcher_routine<false>, string_matcher_routine>);
+	f.register_recognizer(TYPE_CHARSET, &u::construct<u::parser_charset_routine<false>, charset_routine>);
+	f.register_recognizer(TYPE_REGEX, &u::construct<u::parser_regex_routine<false>, regex_routine>);
+	f.register_recognizer(TYPE_DELIMITED, &u::construct<u::parser_delimited_routine<false>, delimited_routine>);
+	f.register_recognizer(TYPE_LAMBDA, &u::construct<u::parser_lambda_routine<false>, lambda_routine>);
+	f.register_recognizer(TYPE_INLINE, &u::construct_inline_recognizer);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -499,13 +975,27 @@ dvl::parser_routine_factory::default_config(parser_routine_factory &f)
 //
 
 dvl::parser::stack_frame::stack_frame(const stack_frame &f):
-		stream_marker(f.stream_marker)
+		stream_marker(f.stream_marker),
+		node_mark(f.node_mark)
 {
 	cur = f.cur;
 	next = f.next;
 	repeat = f.repeat;
 	repeated = f.repeated;
 	result = f.result;
+	entered = f.entered;
+	wrapped = f.wrapped;
+	detached = f.detached;
+	silent = f.silent;
+	lookahead = f.lookahead;
+	start = f.start;
+	t_begin = f.t_begin;
+	t_child = f.t_child;
+
+	if(f.splice == &f.result)
+		splice = &result;
+	else
+		splice = f.splice;
 
 	if(f.next_insert == &f.result)
 		next_insert = &result;
@@ -513,19 +1003,61 @@ dvl::parser::stack_frame::stack_frame(const stack_frame &f):
 		next_insert = f.next_insert;
 }
 
+void
+dvl::parser::splice(stack_frame &f)
+{
+	lnstruct *ln = *f.splice;
+	lnstruct *children = ln->get_child();
+	ln->get_child() = nullptr;
+
+	// ln is the last output of the frame, thus ln->get_next() is empty
+	*f.splice = children;
+	f.next_insert = f.splice;
+
+	while(*f.next_insert != nullptr)
+		f.next_insert = &(*f.next_insert)->get_next();
+
+	// the routine doesn't own its output
+	delete ln;
+}
+
+std::size_t
+dvl::parser::commit_mark()
+{
+	std::size_t mark = node_ct;
+	bool popped = false;
+
+	for(auto it = s.c.rbegin(); it != s.c.rend(); it++)
+	{
+		popped = (popped && !it->repeat) || it->next != nullptr || it->cur->may_fail();
+
+		if(popped)
+			mark = it->node_mark;
+	}
+
+	return mark;
+}
+
+template<bool build, bool instrument>
 void
 dvl::parser::unwind()
 	throw(parser_exception)
 {
 	try{
 		{	// pop first frame irrespective of it's state
-			lnstruct *ln = s.top().result;
+			bool wrapped = s.top().wrapped;
 			if(s.top().next != nullptr && s.top().next != s.top().cur)
 				delete s.top().next;
-			delete s.top().cur;
+			s.top().next = nullptr;
+			complete<instrument>(s.top());
+
+			lnstruct *ln = s.top().result;	// may be altered by completion
 
 			s.pop();
 
+			if(build && wrapped)
+				emit_exit(position());
+
 			if(s.empty())
 				throw parser_exception(PARSER, "Failed to unwind - only one routine present");
 
@@ -535,11 +1067,16 @@ dvl::parser::unwind()
 		while(!s.empty() && !s.top().repeat && s.top().next == nullptr)
 		{
 			stack_frame &f = s.top();
+			bool wrapped = f.wrapped;
+			complete<instrument>(f);
+
 			lnstruct *ln = f.result;
-			delete f.cur;
 
 			s.pop();
 
+			if(build && wrapped)
+				emit_exit(position());
+
 			if(!s.empty())
 				s.top().cur->ri_place_child(ln);	// chain output
 		}
@@ -548,24 +1085,31 @@ dvl::parser::unwind()
 		{
 			// step
 			if(s.top().repeat)
+			{
 				s.top().repeat = false;
+
+				// output accepted by a fork or loop
+				if(build && !context.listeners.empty())
+					emit_commit(commit_mark());
+			}
 			else
-				s.top().switch_to_next_routine();
+				complete<instrument>(s.top());
 		}
 	}catch(const parser_exception &ex)
 	{
+#ifdef PARSER_TRACE
 		std::cout << "exception in unwind: " << ex.what() << std::endl;
+#endif
 
-		if(e != nullptr)
-			delete e;
-
-		e = ex.clone();
+		e = ex;
+		failed = true;
 
 		// ex
-		unwind_ex();
+		unwind_ex<build, instrument>();
 	}
 }
 
+template<bool build, bool instrument>
 void
 dvl::parser::unwind_ex()
 	throw(parser_exception)
@@ -575,12 +1119,20 @@ dvl::parser::unwind_ex()
 
 	// pop
 	{
-		delete s.top().result;
+		if(instrument)
+			instrument_exit(s.top(), false);
+
+		seek(s.top().stream_marker, s.top().cur->get_pid());
+
+		if(build)
+			delete s.top().result;
+		delete s.top().detached;
 		if(s.top().next != nullptr && s.top().next != s.top().cur)
 			delete s.top().next;
 		delete s.top().cur;
 
-		context.str.seekg(s.top().stream_marker, std::ios::beg);
+		if(build)
+			emit_rewind(s.top().node_mark);
 
 		s.pop();
 	}
@@ -588,20 +1140,113 @@ dvl::parser::unwind_ex()
 	// pop_ex
 	while(!s.empty() && !s.top().repeat)
 	{
+		if(instrument)
+			instrument_exit(s.top(), false);
+
 		// reset stream position
-		context.str.seekg(s.top().stream_marker, std::ios::beg);
+		seek(s.top().stream_marker, s.top().cur->get_pid());
 
-		delete s.top().result;
+		if(build)
+			delete s.top().result;
+		delete s.top().detached;
 		if(s.top().next != nullptr && s.top().next != s.top().cur)
 			delete s.top().next;
 		delete s.top().cur;
 
+		if(build)
+			emit_rewind(s.top().node_mark);
+
 		s.pop();
 	}
 
 	// step
 	if(!s.empty())
+	{
 		s.top().repeat = false;
+
+		// an iteration of the root-loop failed
+		if(context.sync != nullptr && s.size() == 2)
+			recover<build>();
+	}
+}
+
+template<bool build>
+void
+dvl::parser::recover()
+	throw(parser_exception)
+{
+	long start = position();
+
+	// a failing iteration at the end of the input terminates the loop
+	if(context.str.peek() == WEOF)
+	{
+		position();
+		return;
+	}
+
+	long end = resync();
+
+	errors.push_back({start, end, farthest, expected.pids()});
+
+	stack_frame &f = s.top();
+
+	// the loop might be a recognizer
+	if(build && f.cur->get_result() != nullptr)
+	{
+		lnstruct *ln = new lnstruct(PARSE_ERROR, start);
+		ln->set_end(end);
+
+		if(!f.silent)
+		{
+			if(f.cur->wraps_children())
+				emit_enter(LOOP_HELPER, start);
+
+			emit_enter(PARSE_ERROR, start);
+			emit_exit(end);
+
+			if(f.cur->wraps_children())
+				emit_exit(end);
+		}
+
+		f.cur->ri_place_child(ln);
+	}
+	else
+		f.cur->ri_place_child(nullptr);
+
+	// the loop continues
+	failed = false;
+}
+
+long
+dvl::parser::resync()
+	throw(parser_exception)
+{
+	for(long pos = position();; pos++)
+	{
+		seek(pos, context.sync->get_pid());
+
+		if(context.str.peek() == WEOF)
+			return position();
+
+		update.reset();
+
+		std::unique_ptr<proutine> r(context.factory.build_recognizer(context.sync));
+
+		try{
+			r->ri_run(*this);
+		}catch(const parser_exception&)
+		{
+			continue;
+		}
+
+		if(update.child != nullptr || update.next != nullptr || update.repeat)
+			throw parser_exception(PARSER, "The sync-routine must be a terminal");
+
+		// empty matches don't advance the input
+		long end = position();
+		if(end > pos)
+			return end;
+	}
 }
 
 dvl::parser::parser(parser_context &context)
@@ -614,12 +1259,30 @@ dvl::parser::parser(parser_context &context)
 	if(!context.str)
 		throw parser_exception(PARSER, "Can't read input");
 
-	stack_frame f(context.str.tellg());
+	if(context.sync != nullptr && context.builder.get()->get_pid().get_type() != TYPE_LOOP)
+		throw parser_exception(PARSER, "Recovery requires a loop_routine as root");
+
+	if(context.heat != nullptr)
+	{
+		context.heat->index(context.input());
+		heat_pos = context.str.tellg();
+	}
+
+	if(context.trace != nullptr)
+		tracer = context.trace->get_writer();
+
+	stack_frame f(context.str.tellg(), 0);
 	f.cur = new output_helper(result, context.builder.get());
 	s.push(f);
 }
 
 dvl::parser::~parser()
+{
+	clear_stack();
+}
+
+void
+dvl::parser::clear_stack()
 {
 	while(!s.empty())
 	{
@@ -628,10 +1291,11 @@ dvl::parser::~parser()
 		// destroy any output generated within the frame
 		if(f.result != nullptr)
 			delete f.result;
-		else if(f.cur != nullptr && f.cur->get_result() != nullptr)
+		else if(f.cur != nullptr && f.cur->get_result() != nullptr && f.cur->get_result() != f.detached)
 			delete f.cur->get_result();
 
 		// destroy routines in the frame
+		delete f.detached;
 		delete f.cur;
 
 		if(f.next != nullptr && f.next != f.cur)
@@ -642,29 +1306,57 @@ dvl::parser::~parser()
 	}
 }
 
+template<bool build, bool instrument>
 void
-dvl::parser::run()
+dvl::parser::steps()
 	throw(parser_exception)
 {
+	// routines whose output is discarded only recognize the input
+	auto construct = [this](routine *r, bool silent){
+		return !build || silent || r->get_output_policy() == output_policy::SILENT ?
+				context.factory.build_recognizer(r) : context.factory.build_routine(r);
+	};
+
 	while(!s.empty())
 	{
+		if(++step_ct >= next_check)
+			check_limits();
+
+		if(context.sampler != nullptr && context.sampler->pending())
+			sample();
+
 		update.reset();
 
+		// only the first run of a routine tests the input
+		long start = s.top().repeated ? -1 : position();
+
+		if(instrument)
+			instrument_run(s.top(), start);
+
+#ifdef PARSER_TRACE
 		std::wcout << L"Running routine :" << context.pt.to_string(s.top().cur->get_pid()) << std::endl;
+#endif
 
 		try{
 			// run
 			s.top().cur->ri_run(*this);
 
 			// done
-			e = nullptr;	// reset exception-flag
+			failed = false;	// reset exception-flag
 		}catch(parser_exception &ex)
 		{
+#ifdef PARSER_TRACE
 			std::cout << "exception in run: " << ex.what() << std::endl;
+#endif
+
+			// failures within a lookahead aren't expected input
+			if(start >= 0 && s.top().lookahead == 0)
+				record_failure(s.top().cur, start);
 
-			e = ex.clone();
+			e = ex;
+			failed = true;
 
-			unwind_ex();
+			unwind_ex<build, instrument>();
 
 			continue;
 		}
@@ -674,9 +1366,26 @@ dvl::parser::run()
 
 		if(!f.repeated)
 		{
+			lnstruct *ln = f.cur->get_result();
+			output_policy policy = (!build || f.silent ? output_policy::SILENT : f.cur->get_output_policy());
+
+			if(build && ln != nullptr && policy == output_policy::EMIT)
+			{
+				emit_enter(f.cur->get_pid(), ln->get_start());
+				f.entered = true;
+			}
+
 			// place output
-			*f.next_insert = f.cur->get_result();
-			f.next_insert = &(*f.next_insert)->get_next();
+			if(build && context.build_tree && ln != nullptr && policy != output_policy::SILENT)
+			{
+				if(policy == output_policy::TRANSPARENT)
+					f.splice = f.next_insert;
+
+				*f.next_insert = ln;
+				f.next_insert = &(*f.next_insert)->get_next();
+			}
+			else
+				f.detached = ln;
 
 			f.repeated = true;
 		}
@@ -688,13 +1397,22 @@ dvl::parser::run()
 			if(f.next != nullptr)
 				delete f.next;
 
-			f.next = context.factory.build_routine(update.next);
+			f.next = construct(update.next, f.silent);
 		}
 
 		if(update.child != nullptr)
 		{
-			stack_frame nf(context.str.tellg());
-			nf.cur = context.factory.build_routine(update.child);
+			stack_frame nf(position(), node_ct);
+			nf.silent = (f.silent || f.cur->get_output_policy() == output_policy::SILENT ||
+					f.cur->recognizes_children());
+			nf.lookahead = f.lookahead + (f.cur->recognizes_children() ? 1 : 0);
+			nf.cur = construct(update.child, nf.silent);
+
+			if(build && f.cur->wraps_children() && !nf.silent)
+			{
+				emit_enter(LOOP_HELPER, nf.stream_marker);
+				nf.wrapped = true;
+			}
 
 			s.push(nf);
 
@@ -706,15 +1424,229 @@ dvl::parser::run()
 		if(update.repeat)
 			s.top().repeat = false;
 		else if(update.next != nullptr)
-			s.top().switch_to_next_routine();
+			complete<instrument>(s.top());
 		else
-			unwind();
+			unwind<build, instrument>();
 	}
 }
 
 void
-dvl::parser::visit(stack_trace_routine&)
+dvl::parser::run()
+	throw(parser_exception)
+{
+	if(context.prof != nullptr || context.trace != nullptr)
+		steps<true, true>();
+	else
+		steps<true, false>();
+
+	count_reads();
+
+	// output of a successful run is final
+	if(node_ct > 0)
+		emit_commit(node_ct);
+}
+
+dvl::recognition_result
+dvl::parser::recognize()
+	throw(parser_exception)
+{
+	if(context.prof != nullptr || context.trace != nullptr)
+		steps<false, true>();
+	else
+		steps<false, false>();
+
+	count_reads();
+
+	// a successful run resets the exception-flag
+	return {!failed && errors.empty(), farthest, expected.pids()};
+}
+
+void
+dvl::parser::instrument_run(stack_frame &f, long start)
+{
+	if(f.repeated)
+	{
+		if(context.prof != nullptr)
+			context.prof->get(f.cur->get_index(), f.cur->get_pid()).repeats++;
+
+		return;
+	}
+
+	f.start = start;
+
+	if(context.trace != nullptr)
+		tracer.record(trace_recorder::kind::BEGIN, f.cur->get_pid(), start);
+
+	if(context.prof != nullptr)
+	{
+		context.prof->get(f.cur->get_index(), f.cur->get_pid()).invocations++;
+		f.t_begin = profiler::ticks();
+	}
+}
+
+void
+dvl::parser::instrument_exit(stack_frame &f, bool success)
+{
+	// the routine might not have run yet
+	if(f.cur == nullptr || f.start < 0)
+		return;
+
+	long pos = position();
+
+	if(context.trace != nullptr)
+		tracer.record(success ? trace_recorder::kind::END : trace_recorder::kind::FAIL, f.cur->get_pid(), pos);
+
+	if(context.prof == nullptr)
+	{
+		f.start = -1;
+		return;
+	}
+
+	profiler::counters &c = context.prof->get(f.cur->get_index(), f.cur->get_pid());
+	uint64_t t = profiler::ticks() - f.t_begin;
+
+	if(success)
+	{
+		c.successes++;
+		c.consumed += pos - f.start;
+	}
+	else
+	{
+		c.failures++;
+
+		// the input is rewound to the start of the frame
+		if(pos > f.stream_marker)
+			c.rewound += pos - f.stream_marker;
+	}
+
+	c.inclusive += t;
+	c.exclusive += t - std::min(t, f.t_child);
+
+	// the inclusive time of a routine is part of the time of its parent
+	if(s.size() >= 2)
+		s.c[s.size() - 2].t_child += t;
+
+	f.start = -1;
+}
+
+void
+dvl::parser::check_limits()
+	throw(parser_exception)
+{
+	typedef std::chrono::steady_clock clock;
+
+	const char *msg = nullptr;
+
+	if(context.max_steps != 0 && step_ct > context.max_steps)
+		msg = "Step budget exceeded";
+	else if(context.cancel != nullptr && context.cancel->load(std::memory_order_relaxed))
+		msg = "Parser was cancelled";
+	else if(context.deadline != clock::time_point::max() && clock::now() >= context.deadline)
+		msg = "Deadline exceeded";
+
+	if(msg == nullptr)
+	{
+		next_check = step_ct + std::max<uint32_t>(context.check_interval, 1);
+
+		if(context.max_steps != 0 && next_check > context.max_steps + 1)
+			next_check = context.max_steps + 1;
+
+		return;
+	}
+
+	// abort the run, revoking all output
+	count_reads();
+	clear_stack();
+	emit_rewind(0);
+
+	throw parser_exception(PARSER, msg);
+}
+
+void
+dvl::parser::count_reads()
+{
+	if(context.heat == nullptr)
+		return;
+
+	long pos = position();
+
+	context.heat->consume(heat_pos, pos);
+	heat_pos = pos;
+}
+
+void
+dvl::parser::seek(long pos, const pid &id)
+{
+	if(context.heat != nullptr)
+	{
+		long cur = position();
+
+		count_reads();
+
+		if(pos < cur)
+			context.heat->rewind(pos, cur, id);
+
+		heat_pos = pos;
+	}
+
+	if(context.trace != nullptr)
+	{
+		long cur = position();
+
+		if(pos < cur)
+			tracer.record(trace_recorder::kind::BACKTRACK, id, pos, cur);
+	}
+
+	context.str.clear();
+	context.str.seekg(pos, std::ios::beg);
+}
+
+std::wstring
+dvl::parser::get_failure_message()
+	const
+{
+	if(farthest < 0)
+		return L"";
+
+	std::wstring msg = L"Parse error at offset " + std::to_wstring(farthest) + L": expected ";
+
+	std::vector<pid> ids = expected.pids();
+	for(std::size_t i = 0; i < ids.size(); i++)
+	{
+		if(i > 0)
+			msg += L", ";
+
+		msg += context.pt.to_string(ids[i]);
+	}
+
+	return msg;
+}
+
+void
+dvl::parser::visit(stack_trace_routine &r)
+{
+	std::wostream &out = r.get_stream();
+
+	out << L"stack trace at offset " << position() << L":" << std::endl;
+
+	// most recent frame first
+	for(auto it = s.c.rbegin(); it != s.c.rend(); it++)
+		out << L"\t" << context.pt.to_string(it->cur->get_pid()) << L" at offset " << it->stream_marker
+				<< std::endl;
+}
+
+void
+dvl::parser::get_stack(std::vector<pid> &stack)
+{
+	stack.clear();
+
+	for(stack_frame &f : s.c)
+		stack.push_back(f.cur->get_pid());
+}
+
+void
+dvl::parser::sample()
 {
-	// TODO
-	std::cout << "Here should go a stacktrace" << std::endl;
+	get_stack(sample_stack);
+	context.sampler->record(sample_stack);
 }
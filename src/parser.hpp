@@ -11,6 +11,9 @@
 #include <algorithm>
 #include <functional>
 #include <map>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <stack>
 #include <set>
 #include <boost/regex.hpp>
@@ -19,7 +22,15 @@
 #include "id/pid.hpp"
 #include "util/util.hpp"
 #include "outp/lnstruct.hpp"
+#include "outp/parse_listener.hpp"
+#include "outp/text_view.hpp"
 #include "syntax/routines.hpp"
+#include "syntax/cursor.hpp"
+#include "syntax/grammar_index.hpp"
+#include "util/heatmap.hpp"
+#include "util/profiler.hpp"
+#include "util/sampler.hpp"
+#include "util/trace.hpp"
 #include "ex.hpp"
 
 namespace dvl
@@ -92,6 +103,41 @@ namespace dvl
 		 */
 		virtual std::wistream& get_istream() = 0;
 
+		/**
+		 * Provides a cursor over the input positioned at the current position of the
+		 * input-stream. Moving the cursor has no effect on the input-stream until the
+		 * cursor is committed.
+		 *
+		 * @return a cursor at the current position of the input
+		 * @see input_cursor
+		 */
+		virtual input_cursor get_cursor() = 0;
+
+		/**
+		 * Moves the input-stream to the position of the given cursor
+		 *
+		 * @param c a cursor obtained via get_cursor()
+		 */
+		virtual void commit(const input_cursor &c) = 0;
+
+		/**
+		 * Moves the input-stream back to a position that was read before. Routines should
+		 * rewind the input via this method instead of seeking the input-stream directly.
+		 *
+		 * @param pos the new position of the input-stream
+		 */
+		virtual void rewind(long pos) = 0;
+
+		/**
+		 * Provides the cache to match with the given dfa. Grammars are shared between
+		 * parsers, thus the states generated while matching are kept by the parser.
+		 *
+		 * @param dfa the dfa of a regex_routine
+		 * @return the cache of this parser for dfa
+		 * @see lazy_dfa::cache
+		 */
+		virtual lazy_dfa::cache &get_dfa_cache(const lazy_dfa &dfa) = 0;
+
 		/**
 		 * Used to display a stacktrace for the specified stack_trace_routine
 		 *
@@ -168,11 +214,42 @@ namespace dvl
 			 */
 			virtual lnstruct* get_result() = 0;
 
+			/**
+			 * Returns true if the output of each child of this routine should be wrapped
+			 * into a separate LOOP_HELPER-node. The parser needs this information to report
+			 * the wrapping node to its listeners.
+			 *
+			 * @return true if the output of the children is wrapped
+			 * @see parse_listener
+			 */
+			virtual bool wraps_children() const { return false; }
+
+			/**
+			 * Returns true if the children of this routine are only run to recognize the
+			 * input. The output of such children is neither placed nor reported to listeners.
+			 *
+			 * @return true if the output of the children is discarded
+			 * @see predicate_routine
+			 */
+			virtual bool recognizes_children() const { return false; }
+
+			/**
+			 * Returns false if this routine won't fail in any further run. I.e. the
+			 * output of the routine is final, once all children succeeded. Used by the
+			 * parser to determine which output can't be revoked anymore.
+			 *
+			 * @return true if a further run of this routine may fail
+			 * @see parse_listener::commit(std::size_t)
+			 */
+			virtual bool may_fail() const { return true; }
+
 		protected:
 			/**
 			 * Callback to place the lnstruct produced by the child in the
 			 * parents lnstruct. Note that this function will only be called
-			 * if the previous child-routine didn't fail.
+			 * if the previous child-routine didn't fail. If the parser doesn't retain
+			 * any output (see parser_context::build_tree), l will be a nullptr and merely
+			 * signals the successful completion of the child.
 			 *
 			 * This method may throw an exception in case of an invalid insertion.
 			 * E.g. if the routine itself wasn't run yet, or the input is invalid.
@@ -219,9 +296,10 @@ namespace dvl
 			/**
 			 * Called by the routine-interface to place a child-element. Prevents
 			 * repetitive/invalid calls of place_child. I.e. at most one child-element
-			 * may be placed in this routine per call to run. It is not allowed to insert
-			 * a nullptr as child, as this would possibly break the output-tree apart.
+			 * may be placed in this routine per call to run. A nullptr is only passed by
+			 * parsers that don't retain their output.
 			 *
+			 * @see parser_context::build_tree
 			 * @see place_child
 			 * @see legal_insert
 			 */
@@ -231,9 +309,6 @@ namespace dvl
 				if(!legal_insert)
 					throw parser_exception(get_pid(), parser_exception::lnstruct_invalid_insertion("routine"));
 
-				if(l == nullptr)
-					throw dvl::parser_exception(get_pid(), dvl::parser_exception::nullptr_error("Child may not be null"));
-
 				legal_insert = false;
 
 				place_child(l);
@@ -279,13 +354,31 @@ namespace dvl
 		 */
 		typedef std::function<parser_routine*(routine*)> transform;
 
+		/**
+		 * Plain function transforming a routine into a parser_routine. In contrast to
+		 * transform calling a constructor requires a single indirect call.
+		 *
+		 * @see register_constructor
+		 */
+		typedef parser_routine *(*constructor)(routine*);
+
+		/**
+		 * Selects the constructor for a specific routine. Used for types, where the
+		 * constructor depends on more than the type of the pid (e.g. TYPE_INTERNAL).
+		 *
+		 * @see register_resolver
+		 * @see bind
+		 */
+		typedef constructor (*resolver)(routine*);
+
 		parser_routine_factory();
 		virtual ~parser_routine_factory(){}
 
 		/**
 		 * Translates a routine into a parser_routine
 		 * based on the type provided with the pid of the
-		 * routine given as parameter
+		 * routine given as parameter. Routines bound via bind are
+		 * built without any lookup.
 		 *
 		 * @see pid
 		 * @see routine
@@ -293,30 +386,111 @@ namespace dvl
 		 */
 		parser_routine* build_routine(routine* r) throw(parser_exception);
 
+		/**
+		 * Translates a routine into a parser_routine that only recognizes the input. The
+		 * produced routine doesn't allocate any output, i.e. get_result() yields a nullptr.
+		 * Falls back to build_routine, if no recognizer is registered for the type of the
+		 * routine.
+		 *
+		 * @see register_recognizer
+		 * @see parser::recognize()
+		 */
+		parser_routine* build_recognizer(routine* r) throw(parser_exception);
+
 		/**
 		 * Registers a transformation-routine to generate
-		 * a parser_routine from a given routine
+		 * a parser_routine from a given routine. Replaces any constructor
+		 * registered for the type.
 		 */
 		void register_transformation(uint8_t type, transform t);
 
+		/**
+		 * Registers a constructor to generate a parser_routine from a given routine.
+		 * Replaces any transformation registered for the type.
+		 */
+		void register_constructor(uint8_t type, constructor c);
+
+		/**
+		 * Registers a resolver for routines of the given type. The resolver is
+		 * used by bind to select the constructor of each routine.
+		 */
+		void register_resolver(uint8_t type, resolver r);
+
+		/**
+		 * Registers a constructor for recognizers of the given type. Registering a
+		 * transformation or constructor for the type drops its recognizer.
+		 *
+		 * @see build_recognizer
+		 */
+		void register_recognizer(uint8_t type, constructor c);
+
+		/**
+		 * Precomputes the constructor for each routine of the grammar. Afterwards any
+		 * routine numbered by gi is built by a single call to its constructor. Must be
+		 * repeated, if the grammar is renumbered. Registering transformations, constructors
+		 * or resolvers drops all bindings.
+		 *
+		 * @param gi the numbering of the grammar
+		 * @see grammar_index
+		 */
+		void bind(const grammar_index &gi);
+
 		/**
 		 * Registers the standard-routines with the specified factory
 		 *
 		 * This includes: @link fork_routine, @link empty_routine
-		 * @link loop_routine, @link struct_routine, @link string_matcher_routine,
-		 * @link empty_routine, @link echo_routine, @link stack_trace_routine
+		 * @link loop_routine, @link sequence_routine, @link predicate_routine,
+		 * @link struct_routine, @link string_matcher_routine,
+		 * @link empty_routine, @link echo_routine, @link stack_trace_routine,
+		 * @link charset_routine, @link regex_routine, @link delimited_routine,
+		 * @link lambda_routine, @link inline_routine
 		 *
 		 * @param f the factory to configure with the specified routines
 		 */
 		static void default_config(parser_routine_factory &f);
 	private:
 		/**
-		 * Maps types onto the respective transformation-function
+		 * Maps types onto the respective transformation-function, if the type
+		 * has no constructor
 		 *
 		 * @see pid
 		 * @see transform
 		 */
-		std::map<uint8_t, transform> transformations;
+		std::array<transform, 256> transformations;
+
+		/**
+		 * Constructors by type
+		 */
+		std::array<constructor, 256> constructors;
+
+		/**
+		 * Resolvers by type
+		 */
+		std::array<resolver, 256> resolvers;
+
+		/**
+		 * Constructors of recognizers by type
+		 */
+		std::array<constructor, 256> recognizers;
+
+		/**
+		 * Constructor of each routine by index of the routine. The constructor is null
+		 * for routines that are built via transformations.
+		 *
+		 * @see bind
+		 */
+		struct binding
+		{
+			routine *r;
+			constructor c;
+		};
+
+		std::vector<binding> bound;
+
+		/**
+		 * Builds a routine via the transformation for its type
+		 */
+		parser_routine *transform_routine(routine *r) throw(parser_exception);
 	};
 
 	//////////////////////////////////////////////////////////////////////////////////
@@ -367,12 +541,252 @@ namespace dvl
 		 * @see parser_routine_factory
 		 */
 		parser_routine_factory &factory;
+
+		/**
+		 * Listeners receiving the output of the parser as events
+		 *
+		 * @see parse_listener
+		 */
+		std::vector<parse_listener*> listeners;
+
+		/**
+		 * If set to false, the parser won't build a tree of lnstructs. Any lnstruct is
+		 * deallocated as soon as the routine producing it completes, thus the output is
+		 * only available via the listeners.
+		 *
+		 * @see listeners
+		 */
+		bool build_tree = true;
+
+		/**
+		 * If set, the parser recovers from failing iterations of the root of the grammar,
+		 * which must be a loop_routine. The input of the failed iteration is skipped up to
+		 * and including the next match of this routine, replaced by a PARSE_ERROR-node and
+		 * the loop continues. The routine must be a terminal, e.g. a string_matcher_routine
+		 * matching a newline.
+		 *
+		 * @see parser::get_errors()
+		 * @see PARSE_ERROR
+		 */
+		routine *sync = nullptr;
+
+		/**
+		 * Maximum number of steps (runs of routines) of a parser, 0 for no limit
+		 *
+		 * @see parser::run()
+		 */
+		uint64_t max_steps = 0;
+
+		/**
+		 * Point in time by which a parser must have completed
+		 *
+		 * @see parser::run()
+		 */
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+		/**
+		 * If set, the parser stops once the token is set. May be set from any thread.
+		 *
+		 * @see parser::run()
+		 */
+		const std::atomic<bool> *cancel = nullptr;
+
+		/**
+		 * If set, the parser updates the counters of the profiler for each routine it runs
+		 *
+		 * @see profiler
+		 */
+		profiler *prof = nullptr;
+
+		/**
+		 * If set, the parser counts the reads of each offset of the input and charges the
+		 * routines rewinding the input
+		 *
+		 * @see heatmap
+		 */
+		heatmap *heat = nullptr;
+
+		/**
+		 * If set, the parser records its stack whenever the sampler requests a sample
+		 *
+		 * @see stack_sampler
+		 */
+		stack_sampler *sampler = nullptr;
+
+		/**
+		 * If set, the parser records the runs of routines and rewinds of the input as
+		 * trace-events
+		 *
+		 * @see trace_recorder
+		 */
+		trace_recorder *trace = nullptr;
+
+		/**
+		 * Number of steps between two checks of the deadline and the cancellation-token.
+		 * The step budget is checked exactly.
+		 */
+		uint32_t check_interval = 1024;
+
+		/**
+		 * Provides the content of the input-stream as contiguous buffer. The content of the
+		 * stream is copied on the first call, thus modifications of the underlying string
+		 * afterwards won't be visible.
+		 *
+		 * @return the buffered content of the input-stream
+		 */
+		const std::wstring &input()
+		{
+			if(!buffered)
+			{
+				buffer = str.str();
+				buffered = true;
+			}
+
+			return buffer;
+		}
+
+		/**
+		 * Provides the text of a node produced by the parser without copying
+		 *
+		 * @param ln the node
+		 * @return a view into the buffered input
+		 * @see input()
+		 */
+		text_view text(const lnstruct *ln)
+		{
+			return text_of(input(), ln);
+		}
+	private:
+		std::wstring buffer;
+		bool buffered = false;
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////
 	// parser
 	//
 
+	/////////////////////////////////////////////////////////////////////////////////
+	// expected set
+	//
+
+	/**
+	 * Set of the routines that failed at the same offset. Routines are keyed by their dense
+	 * index (see grammar_index), thus once the set has grown to the size of the grammar,
+	 * inserting and clearing neither allocates nor searches. Routines without index are
+	 * compared by pid.
+	 *
+	 * @see parser::get_expected()
+	 */
+	class expected_set
+	{
+	private:
+		/**
+		 * Membership by routine-index
+		 */
+		std::vector<uint64_t> bits;
+
+		/**
+		 * Index and pid of each member in order of insertion
+		 */
+		std::vector<std::pair<std::size_t, pid>> members;
+	public:
+		void insert(std::size_t index, const pid &id)
+		{
+			if(index == routine::NO_INDEX)
+			{
+				for(auto &m : members)
+					if(m.first == index && m.second == id)
+						return;
+			}
+			else
+			{
+				if(index / 64 >= bits.size())
+					bits.resize(index / 64 + 1, 0);
+
+				uint64_t mask = (uint64_t) 1 << (index % 64);
+				if(bits[index / 64] & mask)
+					return;
+
+				bits[index / 64] |= mask;
+			}
+
+			members.emplace_back(index, id);
+		}
+
+		/**
+		 * Removes all members, keeps the allocated storage
+		 */
+		void clear()
+		{
+			for(auto &m : members)
+				if(m.first != routine::NO_INDEX)
+					bits[m.first / 64] = 0;
+
+			members.clear();
+		}
+
+		bool empty() const { return members.empty(); }
+
+		/**
+		 * @return the distinct pids of all members in order of insertion
+		 */
+		std::vector<pid> pids() const
+		{
+			std::vector<pid> r;
+
+			for(auto &m : members)
+				if(std::find(r.begin(), r.end(), m.second) == r.end())
+					r.push_back(m.second);
+
+			return r;
+		}
+	};
+
+	/**
+	 * Outcome of parser::recognize()
+	 *
+	 * @see parser::recognize()
+	 */
+	struct recognition_result
+	{
+		/**
+		 * true if the input is part of the language of the grammar, i.e. the parser
+		 * neither failed nor recovered from an error
+		 */
+		bool matched;
+
+		/**
+		 * The farthest offset at which a routine failed or -1, if no routine failed
+		 */
+		long farthest;
+
+		/**
+		 * The pids of the routines that failed at farthest
+		 */
+		std::vector<pid> expected;
+	};
+
+	/**
+	 * An error the parser recovered from
+	 *
+	 * @see parser_context::sync
+	 */
+	struct parse_error
+	{
+		/**
+		 * The input skipped by the parser
+		 */
+		long start, end;
+
+		/**
+		 * The farthest failure up to the error and the pids expected there
+		 *
+		 * @see parser::get_farthest()
+		 */
+		long farthest;
+		std::vector<pid> expected;
+	};
+
 	// TODO dot-graph in documentation
 
 	/**
@@ -408,7 +822,7 @@ namespace dvl
 			 *
 			 * @see stream_marker
 			 */
-			stack_frame(int pos): stream_marker(pos){}
+			stack_frame(long pos, std::size_t mark): stream_marker(pos), node_mark(mark){}
 
 			/**
 			 * The routine currently running in this stack-frame
@@ -464,16 +878,80 @@ namespace dvl
 			 */
 			const long stream_marker;
 
+			/**
+			 * Number of nodes reported to the listeners when this frame started
+			 * execution. Used to revoke the output of the frame on failure.
+			 *
+			 * @see parse_listener::rewind(std::size_t)
+			 */
+			const std::size_t node_mark;
+
+			/**
+			 * True if the node of the current routine was reported to the listeners
+			 */
+			bool entered = false;
+
+			/**
+			 * True if the output of this frame is wrapped into a helper-node
+			 *
+			 * @see parser_routine::wraps_children()
+			 */
+			bool wrapped = false;
+
+			/**
+			 * True if no output of this frame is placed, since a routine below has the
+			 * output_policy SILENT
+			 */
+			bool silent = false;
+
+			/**
+			 * Number of predicates below this frame. Failures within a lookahead don't
+			 * contribute to the expected set.
+			 *
+			 * @see record_failure(proutine*, long)
+			 */
+			uint32_t lookahead = 0;
+
+			/**
+			 * Slot holding the output of the current routine, if the routine is TRANSPARENT.
+			 * The output will be replaced by its children once the routine completed.
+			 *
+			 * @see output_policy
+			 */
+			lnstruct **splice = nullptr;
+
+			/**
+			 * Output of the current routine, if the parser doesn't build a tree. Will be
+			 * deallocated with the routine.
+			 *
+			 * @see parser_context::build_tree
+			 */
+			lnstruct *detached = nullptr;
+
+			/**
+			 * Offset at which the current routine started, the time of its first run and
+			 * the inclusive time of its children. Only maintained while profiling or tracing.
+			 *
+			 * @see profiler
+			 */
+			long start = -1;
+			uint64_t t_begin = 0, t_child = 0;
+
 			/**
 			 * Switches to the next routine and deallocates the currently active one.
 			 */
 			void switch_to_next_routine()
 			{
 				delete cur;
+				delete detached;
 				cur = next;
 				next = nullptr;
+				detached = nullptr;
+				splice = nullptr;
+				t_child = 0;
 				repeat = false;
 				repeated = false;
+				entered = false;
 			}
 		public:
 			/**
@@ -487,6 +965,15 @@ namespace dvl
 			stack_frame(const stack_frame &frame);
 		};
 
+		/**
+		 * Execution-stack of the parser. Exposes the underlying container to allow
+		 * inspection of frames below the top.
+		 */
+		struct frame_stack : public std::stack<stack_frame>
+		{
+			using std::stack<stack_frame>::c;
+		};
+
 		/**
 		 * Routine required to store the root of the output-tree
 		 * after the routine-execution terminates.
@@ -550,6 +1037,8 @@ namespace dvl
 			 */
 			void run(routine_interface &ri) throw(parser_exception)	{ ri.run_as_child(root); }
 
+			bool may_fail() const { return false; }
+
 		};
 
 		/**
@@ -596,15 +1085,22 @@ namespace dvl
 		 *
 		 * @see stack_frame
 		 */
-		std::stack<stack_frame> s;
+		frame_stack s;
 
 		/**
 		 * Keeps a copy of the latest exception that was thrown in this
-		 * parser in order to keep child-routines stable.
+		 * parser in order to keep child-routines stable. Only valid if failed is set.
+		 * Kept by value, thus the failure of a routine with a static message doesn't allocate.
 		 *
 		 * @see check_child_exception()
+		 * @see failed
 		 */
-		parser_exception *e = nullptr;
+		parser_exception e{PARSER, ""};
+
+		/**
+		 * True if the last routine or unwinding failed
+		 */
+		bool failed = false;
 
 		/**
 		 * The context used to configure this parser
@@ -622,6 +1118,146 @@ namespace dvl
 		 */
 		lnstruct *result = nullptr;
 
+		/**
+		 * Number of nodes currently reported to the listeners
+		 *
+		 * @see parser_context::listeners
+		 */
+		std::size_t node_ct = 0;
+
+		/**
+		 * The farthest offset at which a routine failed in its first run
+		 *
+		 * @see get_farthest()
+		 */
+		long farthest = -1;
+
+		/**
+		 * The routines that failed at farthest
+		 *
+		 * @see get_expected()
+		 */
+		expected_set expected;
+
+		/**
+		 * Records the failure of a routine that started at the given offset
+		 */
+		void record_failure(proutine *r, long start)
+		{
+			if(start < farthest)
+				return;
+
+			if(start > farthest)
+			{
+				farthest = start;
+				expected.clear();
+			}
+
+			expected.insert(r->get_index(), r->get_pid());
+		}
+
+		/**
+		 * Reports a new node to the listeners
+		 */
+		void emit_enter(const pid &id, long start)
+		{
+			node_ct++;
+
+			for(parse_listener *l : context.listeners)
+				l->enter(id, start);
+		}
+
+		/**
+		 * Reports the completion of the innermost open node to the listeners
+		 */
+		void emit_exit(long end)
+		{
+			for(parse_listener *l : context.listeners)
+				l->exit(end);
+		}
+
+		/**
+		 * Revokes all nodes reported after the first mark nodes
+		 */
+		void emit_rewind(std::size_t mark)
+		{
+			if(node_ct <= mark)
+				return;
+
+			node_ct = mark;
+
+			for(parse_listener *l : context.listeners)
+				l->rewind(mark);
+		}
+
+		/**
+		 * Reports the output that can't be revoked anymore to the listeners
+		 */
+		void emit_commit(std::size_t mark)
+		{
+			for(parse_listener *l : context.listeners)
+				l->commit(mark);
+		}
+
+		/**
+		 * Determines the number of nodes that can't be revoked anymore. A frame may still be
+		 * popped, if either its routines may fail, or the failure of a frame above may
+		 * propagate to it, since it doesn't handle the failure of its children.
+		 *
+		 * @return the number of final nodes
+		 * @see parser_routine::may_fail()
+		 */
+		std::size_t commit_mark();
+
+		/**
+		 * Replaces the output of the current TRANSPARENT routine of the frame by its children
+		 *
+		 * @see stack_frame::splice
+		 */
+		void splice(stack_frame &f);
+
+		/**
+		 * Completes the current routine of the frame. Records the end of its output, reports
+		 * the end of its node and switches to the next routine
+		 *
+		 * @tparam instrument true if a profiler or a trace recorder is set
+		 * @see stack_frame::switch_to_next_routine()
+		 */
+		template<bool instrument = false>
+		void complete(stack_frame &f)
+		{
+			if(instrument)
+				instrument_exit(f, true);
+
+			if(f.entered)
+			{
+				long end = position();
+
+				lnstruct *ln = f.cur->get_result();
+				if(end >= ln->get_start())
+					ln->set_end(end);
+
+				emit_exit(end);
+			}
+
+			if(f.splice != nullptr)
+				splice(f);
+
+			f.switch_to_next_routine();
+		}
+
+		/**
+		 * Current offset in the input-stream. Clears the error-state of the stream,
+		 * in case a routine read beyond EOF.
+		 */
+		long position()
+		{
+			if(!context.str.good())
+				context.str.clear();
+
+			return context.str.tellg();
+		}
+
 		/**
 		 * Unwinds the stack until the next routine to run is found.
 		 * The top-most stack will be popped off irrespectively of other
@@ -629,9 +1265,12 @@ namespace dvl
 		 *
 		 * @throw parser_exception if the unwinwding fails
 		 *
+		 * @tparam build false if the parser only recognizes the input
+		 * @tparam instrument true if a profiler or a trace recorder is set
 		 * @see s
 		 * @see unwind_ex()
 		 */
+		template<bool build, bool instrument>
 		void unwind() throw(parser_exception);
 
 		/**
@@ -640,11 +1279,152 @@ namespace dvl
 		 *
 		 * @throw parser_exception if the unwinding fails
 		 *
+		 * @tparam build false if the parser only recognizes the input
+		 * @tparam instrument true if a profiler or a trace recorder is set
 		 * @see s
 		 * @see unwind()
 		 */
+		template<bool build, bool instrument>
 		void unwind_ex() throw(parser_exception);
 
+		/**
+		 * Runs routines until the stack is empty. If build is false, no output is placed
+		 * or reported and all routines are built as recognizers. Otherwise only routines
+		 * whose output is discarded (SILENT routines and anything below) are built as
+		 * recognizers.
+		 *
+		 * @tparam build false if the parser only recognizes the input
+		 * @tparam instrument true if a profiler or a trace recorder is set
+		 * @see run()
+		 * @see recognize()
+		 * @see parser_context::prof
+		 * @see parser_context::trace
+		 */
+		template<bool build, bool instrument>
+		void steps() throw(parser_exception);
+
+		/**
+		 * writer of the trace recorder of the context
+		 *
+		 * @see parser_context::trace
+		 */
+		trace_recorder::writer tracer;
+
+		/**
+		 * Updates the counters of the current routine of the frame and records its begin
+		 * before it runs
+		 *
+		 * @param f the top-most frame
+		 * @param start the current offset, if the routine runs for the first time
+		 */
+		void instrument_run(stack_frame &f, long start);
+
+		/**
+		 * Updates the counters of the current routine of the frame and records its end,
+		 * once it completed or failed
+		 *
+		 * @param f the top-most frame
+		 * @param success false if the routine failed
+		 */
+		void instrument_exit(stack_frame &f, bool success);
+
+		/**
+		 * Offset from which on the input read hasn't been counted by the heatmap yet
+		 *
+		 * @see parser_context::heat
+		 */
+		long heat_pos = 0;
+
+		/**
+		 * Counts the input read since the last movement of the input-stream, if a heatmap
+		 * is set
+		 */
+		void count_reads();
+
+		/**
+		 * Moves the input-stream to the specified position. Input before the current
+		 * position is charged to the routine as rewound by the heatmap.
+		 *
+		 * @param pos the new position of the input-stream
+		 * @param id the routine moving the input
+		 */
+		void seek(long pos, const pid &id);
+
+		/**
+		 * buffer of the stack recorded for the sampler
+		 */
+		std::vector<pid> sample_stack;
+
+		/**
+		 * Records the current stack in the sampler of the context
+		 *
+		 * @see parser_context::sampler
+		 */
+		void sample();
+
+		/**
+		 * Caches of the dfas of regex_routines, created on the first match with each dfa
+		 *
+		 * @see get_dfa_cache(const lazy_dfa&)
+		 */
+		std::map<const lazy_dfa*, lazy_dfa::cache> dfa_caches;
+
+		/**
+		 * Errors the parser recovered from
+		 *
+		 * @see parser_context::sync
+		 */
+		std::vector<parse_error> errors;
+
+		/**
+		 * Recovers from the failure of an iteration of the root-loop, if the loop is on top of
+		 * the stack. Skips the input of the iteration up to the next match of the sync-routine,
+		 * places a PARSE_ERROR-node in the loop and clears the exception-flag.
+		 *
+		 * @tparam build false if the parser only recognizes the input
+		 * @see parser_context::sync
+		 */
+		template<bool build>
+		void recover() throw(parser_exception);
+
+		/**
+		 * Advances the input-stream past the next match of the sync-routine or to the end
+		 * of the input
+		 *
+		 * @return the new position of the input-stream
+		 */
+		long resync() throw(parser_exception);
+
+		/**
+		 * Number of steps run so far
+		 *
+		 * @see parser_context::max_steps
+		 */
+		uint64_t step_ct = 0;
+
+		/**
+		 * Step at which the limits are checked next
+		 *
+		 * @see check_limits()
+		 */
+		uint64_t next_check = 0;
+
+		/**
+		 * Checks the step budget, the cancellation-token and the deadline of the context. If
+		 * any limit is exceeded, the stack is cleared and all output revoked.
+		 *
+		 * @throws parser_exception if a limit is exceeded
+		 * @see parser_context::max_steps
+		 * @see parser_context::deadline
+		 * @see parser_context::cancel
+		 */
+		void check_limits() throw(parser_exception);
+
+		/**
+		 * Pops all frames, destroying their routines and output
+		 */
+		void clear_stack();
+
 		/**
 		 * Asserts that the stack contains at least the root of the parser-graph
 		 */
@@ -679,10 +1459,68 @@ namespace dvl
 		 * Starts this parser. Throws an exception if the language provided to the parser
 		 * doesn't contain the input or if the parser fails internally (e.g. state-inconsistencies)
 		 *
+		 * The run is aborted, if the step budget, the deadline or the cancellation-token of the
+		 * context is exceeded. In this case all output is destroyed, the listeners are rewound
+		 * to 0 and an exception is thrown.
+		 *
 		 * @throw parser_exception if the parser fails
+		 * @see parser_context::max_steps
+		 * @see parser_context::deadline
+		 * @see parser_context::cancel
 		 */
 		void run() throw(parser_exception);
 
+		/**
+		 * Starts this parser in recognition-only mode. No output is built and no listener
+		 * is notified, the parser merely determines whether the input is part of the
+		 * language. May only be called instead of run.
+		 *
+		 * @return whether the input matched, the farthest failure and the pids expected there
+		 * @throw parser_exception if the parser fails internally or a limit is exceeded
+		 * @see parser_routine_factory::build_recognizer
+		 */
+		recognition_result recognize() throw(parser_exception);
+
+		/**
+		 * @return the number of routines run so far
+		 */
+		uint64_t get_steps() const { return step_ct; }
+
+		/**
+		 * Provides the grammar-level stack of the parser
+		 *
+		 * @param stack receives the pids of the routines on the stack from the bottom
+		 * 		frame up
+		 */
+		void get_stack(std::vector<pid> &stack);
+
+		/**
+		 * @return the farthest offset at which a routine failed or -1
+		 */
+		long get_farthest() const { return farthest; }
+
+		/**
+		 * @return the distinct pids of the routines that failed at the farthest offset
+		 * @see get_farthest()
+		 */
+		std::vector<pid> get_expected() const { return expected.pids(); }
+
+		/**
+		 * Describes the farthest failure of this parser, e.g.
+		 * "Parse error at offset 2: expected A, B". The message is only formatted on request.
+		 *
+		 * @return the description of the farthest failure or an empty string, if no routine failed
+		 * @see get_farthest()
+		 * @see get_expected()
+		 */
+		std::wstring get_failure_message() const;
+
+		/**
+		 * @return the errors this parser recovered from in order of their occurrence
+		 * @see parser_context::sync
+		 */
+		const std::vector<parse_error> &get_errors() const { return errors; }
+
 		/**
 		 * Returns the output of this parser. If the parser fails a nullpointer will
 		 * be returned. If the parser succeeds the using routine must get the output
@@ -735,8 +1573,8 @@ namespace dvl
 		void check_child_exception()
 			throw(parser_exception)
 		{
-			if(e != nullptr)
-				throw *e;
+			if(failed)
+				throw e;
 		}
 
 		/**
@@ -748,6 +1586,63 @@ namespace dvl
 		 */
 		std::wistream& get_istream(){ return context.str; }
 
+		/**
+		 * Provides a cursor over the buffered input of the context at the current position
+		 * of the input-stream
+		 *
+		 * @return a cursor at the current position of the input
+		 *
+		 * @see routine_interface::get_cursor()
+		 */
+		input_cursor get_cursor()
+		{
+			const std::wstring &in = context.input();
+			return input_cursor(in.data(), in.data() + in.size(), context.str.tellg());
+		}
+
+		/**
+		 * Moves the input-stream to the position of the cursor
+		 *
+		 * @param c the cursor to commit
+		 *
+		 * @see routine_interface::commit(const input_cursor&)
+		 */
+		void commit(const input_cursor &c)
+		{
+			context.str.clear();
+			context.str.seekg(c.pos());
+		}
+
+		/**
+		 * Rewinds the input on behalf of the running routine
+		 *
+		 * @param pos the new position of the input-stream
+		 *
+		 * @see routine_interface::rewind(long)
+		 */
+		void rewind(long pos)
+		{
+			seek(pos, s.top().cur->get_pid());
+		}
+
+		/**
+		 * Provides the cache of this parser for the dfa
+		 *
+		 * @param dfa the dfa of a regex_routine
+		 * @return the cache for dfa
+		 *
+		 * @see routine_interface::get_dfa_cache(const lazy_dfa&)
+		 */
+		lazy_dfa::cache &get_dfa_cache(const lazy_dfa &dfa)
+		{
+			auto it = dfa_caches.find(&dfa);
+
+			if(it == dfa_caches.end())
+				it = dfa_caches.emplace(&dfa, lazy_dfa::cache(dfa)).first;
+
+			return it->second;
+		}
+
 		/**
 		 * Visitor for a stack_trace routines. Will display the currently
 		 * active stack-trace
@@ -0,0 +1,112 @@
+#ifndef SYNTAX_CURSOR_HPP_
+#define SYNTAX_CURSOR_HPP_
+
+#include <cwchar>
+#include <algorithm>
+
+namespace dvl
+{
+	/////////////////////////////////////////////////////////////////////////////////
+	// input_cursor
+	//
+
+	/**
+	 * Non-virtual cursor over the contiguous input of a parser. In contrast to the input-stream
+	 * provided by the routine_interface, any operation on the cursor is a plain pointer-operation
+	 * and can be inlined.
+	 *
+	 * A cursor is a copy of the current position of the parser. Moving the cursor doesn't affect
+	 * the input-stream, until the cursor is committed via routine_interface::commit.
+	 *
+	 * @see routine_interface::get_cursor()
+	 * @see routine_interface::commit(const input_cursor&)
+	 */
+	class input_cursor
+	{
+	private:
+		/**
+		 * Start and end (exclusive) of the input and the current position within the input
+		 */
+		const wchar_t *first, *last, *cur;
+	public:
+		/**
+		 * Constructs a new cursor over [first, last) at the given offset. Offsets outside of
+		 * the input will be clamped to the end of the input.
+		 *
+		 * @param first the start of the input
+		 * @param last the end of the input (exclusive)
+		 * @param pos the offset of the cursor relative to first
+		 */
+		input_cursor(const wchar_t *first, const wchar_t *last, long pos):
+			first(first), last(last)
+		{
+			seek(pos);
+		}
+
+		/**
+		 * @return true if the cursor reached the end of the input
+		 */
+		bool eof() const { return cur >= last; }
+
+		/**
+		 * @return the character at the current position or WEOF at the end of the input
+		 */
+		wint_t peek() const { return cur < last ? (wint_t) *cur : WEOF; }
+
+		/**
+		 * Reads the character at the current position and advances the cursor
+		 *
+		 * @return the character read or WEOF at the end of the input
+		 */
+		wint_t get() { return cur < last ? (wint_t) *cur++ : WEOF; }
+
+		/**
+		 * Advances the cursor by n characters without exceeding the end of the input
+		 */
+		void advance(long n = 1) { cur = n < last - cur ? cur + n : last; }
+
+		/**
+		 * @return the offset of the cursor within the input
+		 */
+		long pos() const { return cur - first; }
+
+		/**
+		 * Moves the cursor to the specified offset
+		 *
+		 * @param pos the new offset (clamped to the bounds of the input)
+		 */
+		void seek(long pos)
+		{
+			cur = pos < 0 || pos > last - first ? last : first + pos;
+		}
+
+		/**
+		 * Moves the cursor to the given pointer, which must lie within the input
+		 *
+		 * @param p the new position of the cursor
+		 */
+		void set(const wchar_t *p) { cur = std::min(std::max(p, first), last); }
+
+		/**
+		 * @return the number of characters remaining in the input
+		 */
+		long remaining() const { return last - cur; }
+
+		/**
+		 * @return pointer to the current position
+		 */
+		const wchar_t *data() const { return cur; }
+
+		/**
+		 * @return pointer to the start of the input
+		 */
+		const wchar_t *begin() const { return first; }
+
+		/**
+		 * @return pointer to the end of the input (exclusive)
+		 */
+		const wchar_t *end() const { return last; }
+	};
+}
+
+#endif /* SYNTAX_CURSOR_HPP_ */
@@ -39,13 +39,13 @@ const dvl::pid syntax::SYNTAX_ROOT = {syntax::GROUP_SYNTAX_TREE, 0l, dvl::TYPE_L
 						// string
 						syntax::STRING = {syntax::GROUP_SYNTAX_TREE, 400l, dvl::TYPE_STRUCT},
 						syntax::STRING_START = {syntax::GROUP_SYNTAX_TREE, 401l, dvl::TYPE_STRING_MATCHER},
-						syntax::STRING_CONTENT = {syntax::GROUP_SYNTAX_TREE, 402l, dvl::TYPE_LAMBDA},
+						syntax::STRING_CONTENT = {syntax::GROUP_SYNTAX_TREE, 402l, dvl::TYPE_DELIMITED},
 						syntax::STRING_TERMINATOR = {syntax::GROUP_SYNTAX_TREE, 403l, dvl::TYPE_STRING_MATCHER},
 
 						// charset
 						syntax::CHARSET = {syntax::GROUP_SYNTAX_TREE, 500l, dvl::TYPE_STRUCT},
 						syntax::CHARSET_INDICATOR = {syntax::GROUP_SYNTAX_TREE, 501l, dvl::TYPE_STRING_MATCHER},
-						syntax::CHARSET_CONTENT = {syntax::GROUP_SYNTAX_TREE, 502l, dvl::TYPE_LAMBDA},
+						syntax::CHARSET_CONTENT = {syntax::GROUP_SYNTAX_TREE, 502l, dvl::TYPE_DELIMITED},
 						syntax::CHARSET_TERMINATOR = {syntax::GROUP_SYNTAX_TREE, 503l, dvl::TYPE_STRING_MATCHER},
 
 						// name
@@ -126,38 +126,7 @@ syntax::build_syntax_file_definition(dvl::parser_context &c)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_CHILD)
 				.match_string(STRING_START, L"#(").pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_CHILD)
-				.lambda(STRING_CONTENT, [](routine_interface &ri) throw(parser_exception)->lnstruct*{
-					lnstruct *ln = new lnstruct(STRING_CONTENT, ri.get_istream().tellg());
-
-					ri.check_child_exception();	// shouldn't throw, since this routine is child-less
-
-					// read until first unescaped closing-bracket is encountered. Alternatively the
-					// loop terminates if either EOF or the end of the line is encountered
-					bool escaped = false;
-					wint_t c = ri.get_istream().get();
-
-					while(c != WEOF && c != '\n' && !(c == L')' && !escaped))
-					{
-						if(c == L'\\')
-							escaped = !escaped;
-						else
-							escaped = false;
-
-						c = ri.get_istream().get();
-					}
-
-					// check if string-definition is unterminated
-					if(c == WEOF || c == '\n')
-					{
-						delete ln;
-						throw parser_exception(STRING_CONTENT, "Reached EOF while processing definition");
-					}
-
-					// reset stream back before bracket
-					ri.get_istream().seekg(-1l, std::ios::cur);
-
-					return ln;
-				}).pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
+				.match_delimited(STRING_CONTENT, L')', L'\\', L"\n").pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_CHILD)
 				.match_string(STRING_TERMINATOR, L")").pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_CHILD)
@@ -173,38 +142,7 @@ syntax::build_syntax_file_definition(dvl::parser_context &c)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
 				.match_string(CHARSET_INDICATOR, L"$(").pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
-				.lambda(CHARSET_CONTENT, [](routine_interface &ri) throw(parser_exception)->lnstruct*{
-					lnstruct *ln = new lnstruct(CHARSET_CONTENT, ri.get_istream().tellg());
-
-					ri.check_child_exception();	// shouldn't throw, since this routine is child-less
-
-					// read until first unescaped closing-bracket is encountered. Alternatively the
-					// loop terminates if either EOF or the end of the line is encountered
-					bool escaped = false;
-					wint_t c = ri.get_istream().get();
-
-					while(c != WEOF && c != '\n' && !(c == L')' && !escaped))
-					{
-						if(c == L'\\')
-							escaped = !escaped;
-						else
-							escaped = false;
-
-						c = ri.get_istream().get();
-					}
-
-					// check if string-definition is unterminated
-					if(c == WEOF || c == '\n')
-					{
-						delete ln;
-						throw parser_exception(STRING_CONTENT, "Reached EOF while processing definition");
-					}
-
-					// reset stream back before bracket
-					ri.get_istream().seekg(-1l, std::ios::cur);
-
-					return ln;
-				}).pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
+				.match_delimited(CHARSET_CONTENT, L')', L'\\', L"\n").pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_CHILD)
 				.match_string(CHARSET_TERMINATOR, L")").pop_checkpoint().set_insertion_mode(ins_mod::AS_NEXT)
 			.logic(ANONYMOUS_STRUCT).push_checkpoint().set_insertion_mode(ins_mod::AS_CHILD)
@@ -0,0 +1,81 @@
+#include "grammar.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+////////////////////////////////////////////////////////////////////////////////
+// grammar
+//
+
+constexpr dvl::grammar::index dvl::grammar::NONE;
+
+void
+dvl::grammar::subroutines(routine *r, std::vector<routine*> &out)
+{
+	switch(r->get_pid().get_type())
+	{
+	case TYPE_FORK:
+	{
+		std::vector<routine*> &f = ((fork_routine*) r)->forks();
+		out.insert(out.end(), f.begin(), f.end());
+		break;
+	}
+	case TYPE_SEQUENCE:
+	{
+		std::vector<routine*> &e = ((sequence_routine*) r)->elements();
+		out.insert(out.end(), e.begin(), e.end());
+		break;
+	}
+	case TYPE_LOOP:
+		out.push_back(((loop_routine*) r)->get_loop());
+		break;
+	case TYPE_PREDICATE:
+		out.push_back(((predicate_routine*) r)->get_child());
+		break;
+	case TYPE_STRUCT:
+		out.push_back(((struct_routine*) r)->get_child());
+		out.push_back(((struct_routine*) r)->get_next());
+		break;
+	default:
+		break;
+	}
+}
+
+dvl::grammar::grammar(std::vector<routine*> order,
+		const std::vector<std::pair<std::wstring, routine*>> &named, pid_table &pt):
+	gi(order, pt)
+{
+	std::unordered_map<routine*, index> pos;
+	for(std::size_t i = 0; i < order.size(); i++)
+		pos[order[i]] = i;
+
+	nodes.reserve(order.size());
+
+	std::vector<routine*> sub;
+	for(routine *r : order)
+	{
+		sub.clear();
+		subroutines(r, sub);
+
+		nodes.push_back({r->get_pid(), r->get_output_policy(), (index) edge_list.size(),
+			(index) sub.size(), r});
+
+		for(routine *s : sub)
+			edge_list.push_back(s == nullptr ? NONE : pos.at(s));
+	}
+
+	for(auto &n : named)
+		names.emplace_back(n.first, pos.at(n.second));
+
+	std::sort(names.begin(), names.end());
+}
+
+dvl::grammar::index
+dvl::grammar::find(const std::wstring &name)
+	const
+{
+	auto it = std::lower_bound(names.begin(), names.end(), name,
+			[](const std::pair<std::wstring, index> &p, const std::wstring &n){ return p.first < n; });
+
+	return it != names.end() && it->first == name ? it->second : NONE;
+}
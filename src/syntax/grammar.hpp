@@ -0,0 +1,134 @@
+#ifndef SYNTAX_GRAMMAR_HPP_
+#define SYNTAX_GRAMMAR_HPP_
+
+#include "../ex.hpp"
+#include "../id/pid.hpp"
+#include "routines.hpp"
+#include "grammar_index.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace dvl
+{
+	/////////////////////////////////////////////////////////////////////////////////
+	// grammar
+	//
+
+	/**
+	 * Immutable, validated snapshot of the routine-graph of a routine_tree_builder produced by
+	 * routine_tree_builder::freeze. The structure of the graph is stored in two contiguous
+	 * arrays: one node per routine and the edges to the subroutines of all nodes as 32-bit
+	 * indices. Nodes are laid out in breadth-first order starting at the root, thus routines
+	 * that are likely to run in succession are stored close to each other.
+	 *
+	 * The edges of a node are, depending on the type of the routine:
+	 * <ul>
+	 * 	<li>fork_routine: the alternatives in order</li>
+	 * 	<li>sequence_routine: the elements in order</li>
+	 * 	<li>loop_routine: the routine to loop over</li>
+	 * 	<li>predicate_routine: the routine to look ahead for</li>
+	 * 	<li>struct_routine: child and next, either of which may be NONE</li>
+	 * </ul>
+	 *
+	 * The routines themselves remain owned by the builder and are marked as finalized.
+	 * The index of each routine is set to the index of its node.
+	 *
+	 * @see routine_tree_builder::freeze
+	 * @see grammar_index
+	 */
+	class grammar
+	{
+		friend class routine_tree_builder;
+	public:
+		typedef uint32_t index;
+
+		/**
+		 * Represents a missing edge
+		 */
+		static constexpr index NONE = ~(index) 0;
+
+		struct node
+		{
+			pid id;
+
+			output_policy policy;
+
+			/**
+			 * range of the edges of this node in the edge-array
+			 */
+			index first_edge, edge_ct;
+
+			routine *r;
+		};
+
+		/**
+		 * Range of the subroutines of a node
+		 */
+		struct edge_range
+		{
+			const index *first, *last;
+
+			const index *begin() const { return first; }
+			const index *end() const { return last; }
+
+			std::size_t size() const { return last - first; }
+		};
+
+		/**
+		 * Appends the direct subroutines of r to out in the order described above. Missing
+		 * subroutines are appended as nullptr.
+		 */
+		static void subroutines(routine *r, std::vector<routine*> &out);
+	private:
+		std::vector<node> nodes;
+		std::vector<index> edge_list;
+
+		/**
+		 * named nodes sorted by name
+		 */
+		std::vector<std::pair<std::wstring, index>> names;
+
+		grammar_index gi;
+
+		grammar(std::vector<routine*> order, const std::vector<std::pair<std::wstring, routine*>> &named,
+				pid_table &pt);
+	public:
+		/**
+		 * @return the number of nodes
+		 */
+		std::size_t size() const { return nodes.size(); }
+
+		/**
+		 * @return the index of the root-node (always 0)
+		 */
+		index root() const { return 0; }
+
+		const node &get(index i) const { return nodes[i]; }
+
+		edge_range edges(index i) const
+		{
+			const index *f = edge_list.data() + nodes[i].first_edge;
+			return {f, f + nodes[i].edge_ct};
+		}
+
+		/**
+		 * @return the node of the routine with the specified name or NONE
+		 */
+		index find(const std::wstring &name) const;
+
+		/**
+		 * @return the named nodes sorted by name
+		 */
+		const std::vector<std::pair<std::wstring, index>> &get_names() const { return names; }
+
+		/**
+		 * @return the dense numbering of the routines and pids of this grammar
+		 */
+		const grammar_index &get_index() const { return gi; }
+	};
+}
+
+#endif /* SYNTAX_GRAMMAR_HPP_ */
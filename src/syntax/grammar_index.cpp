@@ -0,0 +1,88 @@
+#include "grammar_index.hpp"
+#include "grammar.hpp"
+
+#include <algorithm>
+#include <set>
+
+////////////////////////////////////////////////////////////////////////////////
+// grammar_index
+//
+
+dvl::grammar_index::grammar_index(routine_tree_builder &b, pid_table &pt)
+{
+	std::set<routine*> seen;
+	std::vector<routine*> st;
+
+	auto number = [&](routine *start){
+		st.push_back(start);
+
+		while(!st.empty())
+		{
+			routine *r = st.back();
+			st.pop_back();
+
+			if(r == nullptr || !seen.insert(r).second)
+				continue;
+
+			r->set_index(routines.size());
+			routines.push_back(r);
+
+			// push in reverse order to visit subroutines in their natural order
+			std::size_t first = st.size();
+			grammar::subroutines(r, st);
+			std::reverse(st.begin() + first, st.end());
+		}
+	};
+
+	if(b.root != nullptr)
+		number(b.root);
+
+	for(auto &n : b.name_table)
+		number(n.second);
+
+	for(routine *r : b.routines)
+		number(r);
+
+	build_tables(pt);
+}
+
+dvl::grammar_index::grammar_index(const std::vector<routine*> &order, pid_table &pt):
+	routines(order)
+{
+	for(std::size_t i = 0; i < routines.size(); i++)
+		routines[i]->set_index(i);
+
+	build_tables(pt);
+}
+
+void
+dvl::grammar_index::build_tables(pid_table &pt)
+{
+	std::size_t cap = 16;
+	while(cap < 2 * routines.size())
+		cap <<= 1;
+
+	table.assign(cap, {0, EMPTY_SLOT});
+	mask = cap - 1;
+
+	routine_pids.reserve(routines.size());
+	for(routine *r : routines)
+		routine_pids.push_back(intern(r->get_pid(), pt));
+}
+
+uint32_t
+dvl::grammar_index::intern(const pid &id, pid_table &pt)
+{
+	uint64_t key = id;
+	std::size_t i = hash(key);
+
+	for(; table[i].index != EMPTY_SLOT; i = (i + 1) & mask)
+		if(table[i].key == key)
+			return table[i].index;
+
+	table[i] = {key, (uint32_t) pids.size()};
+	pids.push_back(id);
+	names.push_back(pt.to_string(id, true));
+
+	return pids.size() - 1;
+}
@@ -0,0 +1,141 @@
+#ifndef SYNTAX_GRAMMAR_INDEX_HPP_
+#define SYNTAX_GRAMMAR_INDEX_HPP_
+
+#include "../id/pid.hpp"
+#include "routines.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dvl
+{
+	/////////////////////////////////////////////////////////////////////////////////
+	// grammar_index
+	//
+
+	/**
+	 * Dense numbering of the routines and pids of a grammar. Each routine produced by the
+	 * routine_tree_builder is assigned an index in [0, routine_count()), which is stored in
+	 * the routine itself (routine::get_index()) and passed on to the parser_routines built
+	 * from it. Thus side-tables per routine (statistics, flags, ...) can be plain vectors
+	 * indexed without any lookup.
+	 *
+	 * Likewise each distinct pid of the grammar is assigned an index in [0, pid_count()).
+	 * Pids are resolved via a flat open-addressing hash-table and the names of all pids
+	 * are resolved once on construction, thus neither requires walking the pid_table.
+	 *
+	 * Routines are numbered in depth-first order starting at the root, followed by the named
+	 * routines in order of their names and all remaining routines. The index must be rebuilt
+	 * if routines are added to the builder afterwards.
+	 *
+	 * @see routine::get_index()
+	 * @see routine_tree_builder
+	 */
+	class grammar_index
+	{
+	public:
+		/**
+		 * Returned by lookups of unknown pids
+		 */
+		static const std::size_t NO_INDEX = routine::NO_INDEX;
+	private:
+		std::vector<routine*> routines;
+
+		/**
+		 * pid-index of each routine
+		 */
+		std::vector<uint32_t> routine_pids;
+
+		std::vector<pid> pids;
+
+		/**
+		 * extended names of all pids (see pid_table::to_string)
+		 */
+		std::vector<std::wstring> names;
+
+		/**
+		 * open-addressing hash-table mapping raw pids to indices. Empty slots hold
+		 * EMPTY_SLOT as index.
+		 */
+		struct slot
+		{
+			uint64_t key;
+			uint32_t index;
+		};
+
+		static const uint32_t EMPTY_SLOT = ~(uint32_t) 0;
+
+		std::vector<slot> table;
+
+		/**
+		 * table.size() - 1
+		 */
+		std::size_t mask;
+
+		std::size_t hash(uint64_t v) const
+		{
+			return (std::size_t) ((v * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+		}
+
+		uint32_t intern(const pid &id, pid_table &pt);
+
+		/**
+		 * builds the pid-tables for all numbered routines
+		 */
+		void build_tables(pid_table &pt);
+	public:
+		/**
+		 * Numbers all routines of b and resolves the names of their pids via pt
+		 *
+		 * @param b the builder holding the grammar
+		 * @param pt the table used to resolve names
+		 */
+		grammar_index(routine_tree_builder &b, pid_table &pt);
+
+		/**
+		 * Numbers the given routines in the given order
+		 *
+		 * @param order the routines to number
+		 * @param pt the table used to resolve names
+		 */
+		grammar_index(const std::vector<routine*> &order, pid_table &pt);
+
+		std::size_t routine_count() const { return routines.size(); }
+
+		/**
+		 * @return the routine with the specified index
+		 */
+		routine *get_routine(std::size_t i) const { return routines[i]; }
+
+		std::size_t pid_count() const { return pids.size(); }
+
+		const pid &get_pid(std::size_t i) const { return pids[i]; }
+
+		/**
+		 * @return the index of the pid of the routine with index i
+		 */
+		std::size_t pid_of(std::size_t i) const { return routine_pids[i]; }
+
+		/**
+		 * @return the index of the pid or NO_INDEX, if the pid isn't used by the grammar
+		 */
+		std::size_t index_of(const pid &id) const
+		{
+			uint64_t key = id;
+
+			for(std::size_t i = hash(key); table[i].index != EMPTY_SLOT; i = (i + 1) & mask)
+				if(table[i].key == key)
+					return table[i].index;
+
+			return NO_INDEX;
+		}
+
+		/**
+		 * @return the extended name of the pid with index i
+		 */
+		const std::wstring &name_of(std::size_t i) const { return names[i]; }
+	};
+}
+
+#endif /* SYNTAX_GRAMMAR_INDEX_HPP_ */
@@ -0,0 +1,156 @@
+#ifndef SYNTAX_INLINE_ROUTINE_HPP_
+#define SYNTAX_INLINE_ROUTINE_HPP_
+
+#include "../parser.hpp"
+#include "cursor.hpp"
+
+namespace dvl
+{
+	/////////////////////////////////////////////////////////////////////////////////
+	// inline_routine
+	//
+
+	/**
+	 * Base of all inline_routines. Since the type of the functor is only known to the
+	 * inline_routine itself, the inline_routine needs to produce the parser_routine running it.
+	 *
+	 * @see inline_routine
+	 * @see TYPE_INLINE
+	 */
+	class inline_routine_base : public routine
+	{
+	public:
+		inline_routine_base(pid id)
+			throw(parser_exception):
+			routine(id)
+		{
+			if(id.get_type() != TYPE_INLINE)
+				throw parser_exception(id, parser_exception::invalid_pid("inline_routine"));
+		}
+
+		/**
+		 * Builds the parser_routine running this routine
+		 *
+		 * @return a new parser_routine for this routine
+		 * @see parser_routine_factory
+		 */
+		virtual parser_routine_factory::parser_routine *instantiate() = 0;
+
+		/**
+		 * Builds a parser_routine running this routine without producing output
+		 *
+		 * @return a new parser_routine for this routine
+		 * @see parser_routine_factory::build_recognizer
+		 */
+		virtual parser_routine_factory::parser_routine *instantiate_recognizer() = 0;
+	};
+
+	/**
+	 * The parser_routine produced by inline_routine. The functor is called directly and
+	 * operates on an input_cursor, thus neither the call to the functor nor any read
+	 * from the input requires a virtual call. Instances with build = false don't produce output.
+	 *
+	 * @see inline_routine
+	 */
+	template<typename F, bool build = true>
+	class parser_inline_routine final : public parser_routine_factory::parser_routine
+	{
+	private:
+		F &f;
+
+		lnstruct *ln;
+	public:
+		parser_inline_routine(pid id, F &f):
+			parser_routine(id),
+			f(f),
+			ln(nullptr)
+		{}
+
+		lnstruct *get_result(){ return ln; }
+
+		void place_child(lnstruct *)
+			throw(parser_exception)
+		{
+			throw parser_exception(get_pid(), parser_exception::lnstruct_invalid_insertion("parser_inline_routine"));
+		}
+
+		void run(routine_interface &ri)
+			throw(parser_exception)
+		{
+			input_cursor c = ri.get_cursor();
+			long start = c.pos();
+
+			if(!f(c))
+				throw parser_exception(get_pid(), "No match for inline routine");
+
+			ri.commit(c);
+
+			if(build)
+			{
+				ln = new lnstruct(get_pid(), start);
+				ln->set_end(c.pos());
+			}
+		}
+	};
+
+	/**
+	 * Statically typed alternative to lambda_routine. The functor of type F is called with
+	 * an input_cursor positioned at the current position of the parser. It must advance the
+	 * cursor over the matched input and return true on success. On failure it must either
+	 * return false or throw a parser_exception. The output (an lnstruct spanning the consumed
+	 * input) is produced by the routine itself.
+	 *
+	 * The functor must provide <code>bool operator()(input_cursor&)</code>.
+	 *
+	 * @see routine_tree_builder::scan(pid, F)
+	 * @see input_cursor
+	 * @see TYPE_INLINE
+	 */
+	template<typename F>
+	class inline_routine : public inline_routine_base
+	{
+	private:
+		/**
+		 * The functor implementing this routine
+		 */
+		F f;
+	public:
+		inline_routine(pid id, F f)
+			throw(parser_exception):
+			inline_routine_base(id),
+			f(f)
+		{}
+
+		parser_routine_factory::parser_routine *instantiate()
+		{
+			return new parser_inline_routine<F>(get_pid(), f);
+		}
+
+		parser_routine_factory::parser_routine *instantiate_recognizer()
+		{
+			return new parser_inline_routine<F, false>(get_pid(), f);
+		}
+
+		/**
+		 * Getter for the functor of this routine
+		 *
+		 * @return the functor implementing this routine
+		 */
+		F &get_f(){ return f; }
+	};
+
+	template<typename F>
+	routine_tree_builder&
+	routine_tree_builder::scan(pid id, F f)
+	{
+		routine *rn = new inline_routine<F>(id, f);
+		insert_node(rn);
+
+		ins_mode = insertion_mode::NONE;
+		r = rn;
+
+		return *this;
+	}
+}
+
+#endif /* SYNTAX_INLINE_ROUTINE_HPP_ */
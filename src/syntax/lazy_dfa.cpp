@@ -0,0 +1,626 @@
+#include "lazy_dfa.hpp"
+
+#include <climits>
+
+/////////////////////////////////////////////////////////////////////////////////
+// lazy_dfa
+//
+
+/**
+ * Maximum number of NFA-nodes a pattern may expand to. Bounded repetitions are expanded
+ * into copies of the repeated expression, thus patterns like (a{100}){100} are rejected.
+ */
+static const std::size_t MAX_NFA_NODES = 4096;
+
+/**
+ * Syntax-tree of a pattern
+ */
+struct dvl::lazy_dfa::ast
+{
+	enum kind
+	{
+		EMPTY,
+		SET,
+		CONCAT,
+		ALT,
+		REPEAT
+	};
+
+	kind k;
+
+	/**
+	 * index of the character-set (SET only)
+	 */
+	int set;
+
+	/**
+	 * bounds of the repetition (REPEAT only), max < 0 denotes infinity
+	 */
+	int min, max;
+
+	std::vector<ast> kids;
+
+	ast(kind k): k(k), set(-1), min(0), max(0){}
+};
+
+/**
+ * Recursive-descent parser translating a pattern into an ast. Any unsupported feature
+ * results in a parser_exception.
+ */
+struct dvl::lazy_dfa::pattern_parser
+{
+	lazy_dfa &d;
+
+	const wchar_t *c, *end;
+
+	pattern_parser(lazy_dfa &d, const std::wstring &pattern):
+		d(d), c(pattern.c_str()), end(pattern.c_str() + pattern.length())
+	{}
+
+	void unsupported(const char *what)
+		throw(parser_exception)
+	{
+		throw parser_exception(d.id, std::string("Unsupported regex-feature: ") + what);
+	}
+
+	int add_set(range_set rs, bool negate)
+	{
+		std::sort(rs.begin(), rs.end());
+
+		// merge overlapping/adjacent ranges
+		range_set merged;
+		for(auto &r : rs)
+			if(!merged.empty() && r.first <= merged.back().second + 1)
+				merged.back().second = std::max(merged.back().second, r.second);
+			else
+				merged.emplace_back(r);
+
+		if(negate)
+		{
+			range_set inv;
+			wchar_t lo = 0;
+
+			for(auto &r : merged)
+			{
+				if(r.first > lo)
+					inv.emplace_back(lo, r.first - 1);
+
+				lo = r.second + 1;
+
+				if(r.second == WCHAR_MAX)
+					break;
+			}
+
+			if(merged.empty() || merged.back().second < WCHAR_MAX)
+				inv.emplace_back(lo, WCHAR_MAX);
+
+			merged = inv;
+		}
+
+		d.sets.emplace_back(merged);
+		return d.sets.size() - 1;
+	}
+
+	ast single(wchar_t lo, wchar_t hi)
+	{
+		ast a(ast::SET);
+		a.set = add_set({{lo, hi}}, false);
+		return a;
+	}
+
+	int hex_digit(wchar_t h)
+	{
+		if(h >= L'0' && h <= L'9') return h - L'0';
+		if(h >= L'a' && h <= L'f') return h - L'a' + 10;
+		if(h >= L'A' && h <= L'F') return h - L'A' + 10;
+		return -1;
+	}
+
+	/**
+	 * Parses the escape-sequence following a backslash into the character it denotes
+	 */
+	wchar_t escape()
+		throw(parser_exception)
+	{
+		if(c == end)
+			throw parser_exception(d.id, "Incomplete escape-sequence");
+
+		wchar_t e = *c++;
+
+		switch(e)
+		{
+		case L'n': return L'\n';
+		case L't': return L'\t';
+		case L'r': return L'\r';
+		case L'f': return L'\f';
+		case L'v': return L'\v';
+		case L'a': return L'\a';
+		case L'e': return (wchar_t) 0x1b;
+		case L'x':
+		{
+			unsigned long v = 0;
+
+			if(c < end && *c == L'{')
+			{
+				c++;
+				const wchar_t *first = c;
+				for(; c < end && hex_digit(*c) >= 0; c++)
+					v = v * 16 + hex_digit(*c);
+
+				if(c == end || *c != L'}' || c == first || c - first > 8)
+					unsupported("malformed \\x{...}");
+
+				c++;
+			}
+			else
+			{
+				int ct = 0;
+				for(; ct < 2 && c < end && hex_digit(*c) >= 0; c++, ct++)
+					v = v * 16 + hex_digit(*c);
+
+				if(ct == 0)
+					unsupported("malformed \\x");
+			}
+
+			if(v > (unsigned long) WCHAR_MAX)
+				unsupported("character out of range");
+
+			return (wchar_t) v;
+		}
+		default:
+			// letters and digits denote classes, anchors, backreferences, ...
+			if((e >= L'a' && e <= L'z') || (e >= L'A' && e <= L'Z') || (e >= L'0' && e <= L'9'))
+				unsupported("escape-sequence");
+
+			return e;
+		}
+	}
+
+	ast parse_set()
+		throw(parser_exception)
+	{
+		bool negate = false;
+		if(c < end && *c == L'^')
+		{
+			negate = true;
+			c++;
+		}
+
+		range_set rs;
+		bool first = true;
+
+		while(true)
+		{
+			if(c == end)
+				throw parser_exception(d.id, "Unterminated character-set");
+
+			if(*c == L']' && !first)
+			{
+				c++;
+				break;
+			}
+
+			first = false;
+
+			if(*c == L'[' && c + 1 < end && (c[1] == L':' || c[1] == L'=' || c[1] == L'.'))
+				unsupported("named character-class");
+
+			wchar_t lo = *c++;
+			if(lo == L'\\')
+				lo = escape();
+
+			wchar_t hi = lo;
+			if(c + 1 < end && *c == L'-' && c[1] != L']')
+			{
+				c++;
+				hi = *c++;
+
+				if(hi == L'\\')
+					hi = escape();
+
+				if(hi < lo)
+					throw parser_exception(d.id, "Range out of order");
+			}
+
+			rs.emplace_back(lo, hi);
+		}
+
+		ast a(ast::SET);
+		a.set = add_set(rs, negate);
+		return a;
+	}
+
+	ast parse_atom()
+		throw(parser_exception)
+	{
+		wchar_t ch = *c++;
+
+		switch(ch)
+		{
+		case L'(':
+		{
+			if(c < end && *c == L'?')
+			{
+				if(c + 1 < end && c[1] == L':')
+					c += 2;
+				else
+					unsupported("extended group");
+			}
+
+			ast a = parse_alt();
+
+			if(c == end || *c != L')')
+				throw parser_exception(d.id, "Unbalanced bracket");
+
+			c++;
+			return a;
+		}
+		case L'[':
+			return parse_set();
+		case L'.':
+			return single(0, WCHAR_MAX);
+		case L'\\':
+		{
+			wchar_t e = escape();
+			return single(e, e);
+		}
+		case L'^':
+		case L'$':
+			unsupported("anchor");
+			break;
+		case L'*':
+		case L'+':
+		case L'?':
+		case L'{':
+			unsupported("dangling repetition");
+			break;
+		}
+
+		return single(ch, ch);
+	}
+
+	int parse_num()
+	{
+		int v = -1;
+		for(; c < end && *c >= L'0' && *c <= L'9'; c++)
+		{
+			v = (v < 0 ? 0 : v * 10) + (*c - L'0');
+
+			if(v > (int) MAX_NFA_NODES)
+				unsupported("repetition-bound too large");
+		}
+
+		return v;
+	}
+
+	ast parse_repeat()
+		throw(parser_exception)
+	{
+		ast a = parse_atom();
+
+		if(c == end)
+			return a;
+
+		int min, max;
+		switch(*c)
+		{
+		case L'*':
+			min = 0; max = -1; c++;
+			break;
+		case L'+':
+			min = 1; max = -1; c++;
+			break;
+		case L'?':
+			min = 0; max = 1; c++;
+			break;
+		case L'{':
+			c++;
+			min = parse_num();
+			max = min;
+
+			if(c < end && *c == L',')
+			{
+				c++;
+				max = parse_num();
+			}
+
+			if(min < 0 || c == end || *c != L'}' || (max >= 0 && max < min))
+				unsupported("malformed repetition");
+
+			c++;
+			break;
+		default:
+			return a;
+		}
+
+		if(c < end && (*c == L'?' || *c == L'+' || *c == L'*' || *c == L'{'))
+			unsupported("lazy, possessive or nested repetition");
+
+		ast r(ast::REPEAT);
+		r.min = min;
+		r.max = max;
+		r.kids.emplace_back(a);
+		return r;
+	}
+
+	ast parse_concat()
+		throw(parser_exception)
+	{
+		ast a(ast::CONCAT);
+
+		while(c < end && *c != L'|' && *c != L')')
+			a.kids.emplace_back(parse_repeat());
+
+		if(a.kids.empty())
+			return ast(ast::EMPTY);
+
+		return a;
+	}
+
+	ast parse_alt()
+		throw(parser_exception)
+	{
+		ast a(ast::ALT);
+		a.kids.emplace_back(parse_concat());
+
+		while(c < end && *c == L'|')
+		{
+			c++;
+			a.kids.emplace_back(parse_concat());
+		}
+
+		if(a.kids.size() == 1)
+			return a.kids[0];
+
+		return a;
+	}
+};
+
+dvl::lazy_dfa::lazy_dfa(pid id, const std::wstring &pattern, std::size_t cache_size)
+	throw(parser_exception):
+	id(id),
+	cache_size(std::max(cache_size, (std::size_t) 2))
+{
+	compile(pattern);
+}
+
+void
+dvl::lazy_dfa::compile(const std::wstring &pattern)
+	throw(parser_exception)
+{
+	pattern_parser p(*this, pattern);
+	ast a = p.parse_alt();
+
+	if(p.c != p.end)
+		throw parser_exception(id, "Unbalanced bracket");
+
+	nfa.push_back({MATCH, -1, -1, -1});
+	nfa_start = emit(a, 0);
+
+	build_classes();
+}
+
+int
+dvl::lazy_dfa::emit(const ast &a, int next)
+	throw(parser_exception)
+{
+	if(nfa.size() > MAX_NFA_NODES)
+		throw parser_exception(id, "Unsupported regex-feature: pattern is too large");
+
+	switch(a.k)
+	{
+	case ast::EMPTY:
+		return next;
+	case ast::SET:
+		nfa.push_back({SET, next, -1, a.set});
+		return nfa.size() - 1;
+	case ast::CONCAT:
+		for(auto it = a.kids.rbegin(); it != a.kids.rend(); it++)
+			next = emit(*it, next);
+
+		return next;
+	case ast::ALT:
+	{
+		int result = emit(a.kids.back(), next);
+
+		for(auto it = a.kids.rbegin() + 1; it != a.kids.rend(); it++)
+		{
+			int alt = emit(*it, next);
+			nfa.push_back({SPLIT, alt, result, -1});
+			result = nfa.size() - 1;
+		}
+
+		return result;
+	}
+	case ast::REPEAT:
+	{
+		const ast &body = a.kids[0];
+		int result = next;
+
+		if(a.max < 0)
+		{
+			// loop: split back into the body or leave
+			nfa.push_back({SPLIT, -1, next, -1});
+			int split = nfa.size() - 1;
+			int b = emit(body, split);
+			nfa[split].out = b;
+			result = split;
+		}
+		else
+		{
+			// optional copies: (x(x(x)?)?)?
+			for(int i = a.min; i < a.max; i++)
+			{
+				int b = emit(body, result);
+				nfa.push_back({SPLIT, b, next, -1});
+				result = nfa.size() - 1;
+			}
+		}
+
+		// mandatory copies
+		for(int i = 0; i < a.min; i++)
+			result = emit(body, result);
+
+		return result;
+	}
+	}
+
+	throw parser_exception(id, "Invalid syntax-tree");
+}
+
+void
+dvl::lazy_dfa::build_classes()
+{
+	// every range-border starts a new class
+	for(auto &rs : sets)
+		for(auto &r : rs)
+		{
+			if(r.first > 0)
+				boundaries.emplace_back(r.first);
+
+			if(r.second < WCHAR_MAX)
+				boundaries.emplace_back(r.second + 1);
+		}
+
+	std::sort(boundaries.begin(), boundaries.end());
+	boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+	class_ct = boundaries.size() + 1;
+
+	for(wchar_t ch = 0; ch < 128; ch++)
+		ascii_class[ch] = std::upper_bound(boundaries.begin(), boundaries.end(), ch) - boundaries.begin();
+
+	// membership of each class is determined by its first character
+	set_classes.assign(sets.size() * class_ct, 0);
+	for(std::size_t s = 0; s < sets.size(); s++)
+		for(std::size_t cl = 0; cl < class_ct; cl++)
+		{
+			wchar_t rep = cl == 0 ? 0 : boundaries[cl - 1];
+
+			for(auto &r : sets[s])
+				if(r.first <= rep && rep <= r.second)
+				{
+					set_classes[s * class_ct + cl] = 1;
+					break;
+				}
+		}
+}
+
+void
+dvl::lazy_dfa::add_closure(cache &c, int n)
+	const
+{
+	c.scratch_stack.push_back(n);
+
+	while(!c.scratch_stack.empty())
+	{
+		int x = c.scratch_stack.back();
+		c.scratch_stack.pop_back();
+
+		if(c.scratch_mark[x] == c.generation)
+			continue;
+
+		c.scratch_mark[x] = c.generation;
+
+		if(nfa[x].type == SPLIT)
+		{
+			c.scratch_stack.push_back(nfa[x].out_alt);
+			c.scratch_stack.push_back(nfa[x].out);
+		}
+		else
+			c.scratch_set.push_back(x);
+	}
+}
+
+int
+dvl::lazy_dfa::intern(cache &c, std::vector<int> &set)
+	const
+{
+	std::sort(set.begin(), set.end());
+
+	auto it = c.state_index.find(set);
+	if(it != c.state_index.end())
+		return it->second;
+
+	if(c.states.size() >= c.size)
+		c.flush();
+
+	bool accept = std::find_if(set.begin(), set.end(), [this](int n){
+		return nfa[n].type == MATCH;
+	}) != set.end();
+
+	c.states.push_back({set, accept, set.empty()});
+	c.transitions.resize(c.transitions.size() + class_ct, -1);
+	c.state_index[set] = c.states.size() - 1;
+
+	return c.states.size() - 1;
+}
+
+int
+dvl::lazy_dfa::start_state(cache &c)
+	const
+{
+	if(c.start >= 0)
+		return c.start;
+
+	if(++c.generation == 0)
+	{
+		std::fill(c.scratch_mark.begin(), c.scratch_mark.end(), 0);
+		c.generation = 1;
+	}
+
+	c.scratch_set.clear();
+	add_closure(c, nfa_start);
+
+	c.start = intern(c, c.scratch_set);
+	return c.start;
+}
+
+int
+dvl::lazy_dfa::compute(cache &c, int s, std::size_t cls)
+	const
+{
+	if(++c.generation == 0)
+	{
+		std::fill(c.scratch_mark.begin(), c.scratch_mark.end(), 0);
+		c.generation = 1;
+	}
+
+	c.scratch_set.clear();
+
+	for(int n : c.states[s].nfa)
+		if(nfa[n].type == SET && set_classes[nfa[n].set * class_ct + cls])
+			add_closure(c, nfa[n].out);
+
+	std::size_t flushes = c.flush_ct;
+	int t = intern(c, c.scratch_set);
+
+	// only cache the transition if the source-state survived
+	if(flushes == c.flush_ct)
+		c.transitions[s * class_ct + cls] = t;
+
+	return t;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// lazy_dfa::cache
+//
+
+dvl::lazy_dfa::cache::cache(const lazy_dfa &dfa):
+	size(dfa.cache_size),
+	scratch_mark(dfa.nfa.size(), 0)
+{
+	scratch_stack.reserve(dfa.nfa.size());
+	scratch_set.reserve(dfa.nfa.size());
+}
+
+void
+dvl::lazy_dfa::cache::flush()
+{
+	states.clear();
+	transitions.clear();
+	state_index.clear();
+	start = -1;
+
+	flush_ct++;
+}
@@ -0,0 +1,286 @@
+#ifndef SYNTAX_LAZY_DFA_HPP_
+#define SYNTAX_LAZY_DFA_HPP_
+
+#include "../ex.hpp"
+#include "../id/pid.hpp"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cwchar>
+
+namespace dvl
+{
+	/////////////////////////////////////////////////////////////////////////////////
+	// lazy_dfa
+	//
+
+	/**
+	 * Matcher for a subset of regular expressions that doesn't backtrack. The pattern is compiled
+	 * into a thompson-NFA once on construction, DFA-states are generated from the NFA lazily
+	 * while matching and stored in a cache. This allows matching anchored prefixes of the input
+	 * in linear time. Once all required states are cached, matching doesn't allocate any memory.
+	 *
+	 * The cache is kept separate from the dfa (see lazy_dfa::cache) and passed to each match.
+	 * It is bounded by the number of DFA-states specified on construction of the dfa. If the
+	 * cache is full, it will be flushed and rebuilt while matching.
+	 *
+	 * Supported syntax:
+	 * <ul>
+	 * 	<li>literals and escaped literals, as well as \\n, \\t, \\r, \\f, \\v, \\a, \\e and \\xHH</li>
+	 * 	<li>the wildcard . (matching any character)</li>
+	 * 	<li>character-sets [...] and negated character-sets [^...] including ranges</li>
+	 * 	<li>groups (...) and (?:...)</li>
+	 * 	<li>alternatives |</li>
+	 * 	<li>the greedy repetitions *, +, ?, {n}, {n,} and {n,m}</li>
+	 * </ul>
+	 *
+	 * Any other feature (backreferences, anchors, lookaround, lazy repetitions, named classes,
+	 * locale-dependent classes like \\w or \\d, ...) is considered unsupported and results
+	 * in a parser_exception being thrown on construction.
+	 *
+	 * Matching follows leftmost-longest semantics. I.e. the longest prefix of the input that
+	 * matches the pattern will be reported.
+	 *
+	 * The dfa itself isn't modified after construction and can be shared between threads,
+	 * as long as each thread matches with its own cache.
+	 *
+	 * @see regex_routine
+	 */
+	class lazy_dfa
+	{
+	public:
+		/**
+		 * Default maximum number of DFA-states kept in the cache
+		 */
+		static const std::size_t DEFAULT_CACHE_SIZE = 256;
+	private:
+		/**
+		 * A cached DFA-state
+		 */
+		struct dfa_state
+		{
+			/**
+			 * The sorted set of NFA-nodes represented by this state
+			 */
+			std::vector<int> nfa;
+
+			bool accept;
+
+			/**
+			 * True if no transition from this state may ever lead to an accepting state
+			 */
+			bool dead;
+		};
+	public:
+		/**
+		 * DFA-states and transitions generated while matching. A cache is modified by each
+		 * match and thus must only be used by one thread at a time. It must only be used
+		 * with the dfa it was constructed for.
+		 */
+		class cache
+		{
+			friend class lazy_dfa;
+		private:
+			/**
+			 * transitions[state * class_ct + class] holds the index of the target-state or
+			 * -1 if it wasn't computed yet
+			 */
+			std::vector<dfa_state> states;
+			std::vector<int> transitions;
+			std::map<std::vector<int>, int> state_index;
+
+			/**
+			 * index of the cached start-state or -1 if the state isn't cached
+			 */
+			int start = -1;
+
+			std::size_t size;
+			std::size_t flush_ct = 0;
+
+			/**
+			 * scratch-space for closure-computation. Kept as members to avoid allocation
+			 * while matching.
+			 */
+			std::vector<int> scratch_stack, scratch_set;
+			std::vector<unsigned int> scratch_mark;
+			unsigned int generation = 0;
+
+			void flush();
+		public:
+			/**
+			 * Constructs an empty cache bounded by the cache-size of dfa
+			 *
+			 * @param dfa the dfa to match with this cache
+			 */
+			explicit cache(const lazy_dfa &dfa);
+
+			/**
+			 * Number of times the cache was flushed since construction
+			 *
+			 * @return number of cache-flushes
+			 */
+			std::size_t get_flush_count() const { return flush_ct; }
+		};
+
+		/**
+		 * Constructs a new lazy_dfa from the given pattern.
+		 *
+		 * @param id the pid used for exceptions thrown by this dfa
+		 * @param pattern the regular expression to compile
+		 * @param cache_size the maximum number of states kept in a cache (at least 2)
+		 * @throws parser_exception if the pattern is invalid or uses unsupported features
+		 */
+		lazy_dfa(pid id, const std::wstring &pattern, std::size_t cache_size = DEFAULT_CACHE_SIZE)
+			throw(parser_exception);
+
+		/**
+		 * Determines the length of the longest prefix of the input that is matched by
+		 * the pattern of this dfa. The input is read character by character from the
+		 * provided source until either the source is exhausted (signaled by returning
+		 * WEOF) or no further match is possible.
+		 *
+		 * @param c the cache to generate states in
+		 * @param next a functor returning the next character of the input or WEOF
+		 * @return the length of the longest matching prefix or -1 if no prefix matches
+		 */
+		template<typename Source>
+		long longest_match(cache &c, Source next) const
+		{
+			int s = start_state(c);
+			long result = c.states[s].accept ? 0 : -1;
+
+			for(long len = 1; !c.states[s].dead; len++)
+			{
+				wint_t ch = next();
+				if(ch == WEOF)
+					break;
+
+				s = step(c, s, class_of((wchar_t) ch));
+
+				if(c.states[s].accept)
+					result = len;
+			}
+
+			return result;
+		}
+
+		/**
+		 * Determines the length of the longest prefix of [begin, end) that is matched by
+		 * the pattern of this dfa.
+		 *
+		 * @param c the cache to generate states in
+		 * @param begin the first character of the input
+		 * @param end the end of the input (exclusive)
+		 * @return the length of the longest matching prefix or -1 if no prefix matches
+		 */
+		long longest_match(cache &c, const wchar_t *begin, const wchar_t *end) const
+		{
+			return longest_match(c, [&begin, end]()->wint_t{
+				return begin < end ? (wint_t) *begin++ : WEOF;
+			});
+		}
+	private:
+		/**
+		 * Types of NFA-nodes
+		 */
+		enum node_type
+		{
+			SET,
+			SPLIT,
+			MATCH
+		};
+
+		/**
+		 * Single node of the NFA. SET-nodes transition to out if the character is
+		 * contained in the character-set, SPLIT-nodes epsilon-transition to out and out_alt.
+		 */
+		struct nfa_node
+		{
+			node_type type;
+			int out, out_alt;
+
+			/**
+			 * index of the character-set in sets (SET-nodes only)
+			 */
+			int set;
+		};
+
+		/**
+		 * Inclusive character-ranges
+		 */
+		typedef std::vector<std::pair<wchar_t, wchar_t>> range_set;
+
+		struct ast;
+		struct pattern_parser;
+
+		/**
+		 * pid used for any exception thrown by this dfa
+		 */
+		pid id;
+
+		std::vector<nfa_node> nfa;
+
+		int nfa_start;
+
+		/**
+		 * character-sets referenced by SET-nodes
+		 */
+		std::vector<range_set> sets;
+
+		/**
+		 * Partition of the character-space into classes of characters that can't be
+		 * distinguished by the pattern. boundaries holds the first character of each class
+		 * except the first one.
+		 */
+		std::vector<wchar_t> boundaries;
+
+		/**
+		 * Class-lookup for ASCII-characters
+		 */
+		unsigned short ascii_class[128];
+
+		/**
+		 * membership of each class in each set: set_classes[set * class_ct + class]
+		 */
+		std::vector<char> set_classes;
+
+		std::size_t class_ct;
+
+		/**
+		 * maximum number of states of a cache
+		 */
+		std::size_t cache_size;
+
+		void compile(const std::wstring &pattern) throw(parser_exception);
+
+		int emit(const ast &a, int next) throw(parser_exception);
+
+		void build_classes();
+
+		void add_closure(cache &c, int n) const;
+
+		int intern(cache &c, std::vector<int> &set) const;
+
+		int start_state(cache &c) const;
+
+		int step(cache &c, int s, std::size_t cls) const
+		{
+			int t = c.transitions[s * class_ct + cls];
+			return t >= 0 ? t : compute(c, s, cls);
+		}
+
+		int compute(cache &c, int s, std::size_t cls) const;
+
+		std::size_t class_of(wchar_t c) const
+		{
+			if((unsigned long) c < 128)
+				return ascii_class[(unsigned long) c];
+
+			return std::upper_bound(boundaries.begin(), boundaries.end(), c) - boundaries.begin();
+		}
+	};
+}
+
+#endif /* SYNTAX_LAZY_DFA_HPP_ */
@@ -0,0 +1,405 @@
+#include "pass_manager.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+	/**
+	 * Appends the parameters of the routine of n, that aren't part of the graph, to sig.
+	 * Returns false for routines that can't be compared (lambdas, inline routines, ...).
+	 */
+	bool signature(const dvl::pass_manager::graph::node &n, std::wstring &sig)
+	{
+		auto append = [&sig](const std::wstring &s){
+			sig += std::to_wstring(s.length());
+			sig += L':';
+			sig += s;
+		};
+
+		sig += std::to_wstring((uint64_t) n.id);
+		sig += L':';
+		sig += std::to_wstring((int) n.policy);
+		sig += L':';
+
+		switch(n.id.get_type())
+		{
+		case dvl::TYPE_FORK:
+		case dvl::TYPE_SEQUENCE:
+		case dvl::TYPE_STRUCT:
+		case dvl::TYPE_EMPTY:
+			return true;
+		case dvl::TYPE_LOOP:
+		{
+			dvl::loop_routine *l = (dvl::loop_routine*) n.r;
+			append(std::to_wstring(l->get_min_iterations()) + L',' + std::to_wstring(l->get_max_iterations()) +
+					L',' + std::to_wstring((int) l->get_helper_policy()));
+			return true;
+		}
+		case dvl::TYPE_PREDICATE:
+			sig += ((dvl::predicate_routine*) n.r)->is_negated() ? L'!' : L'&';
+			return true;
+		case dvl::TYPE_STRING_MATCHER:
+			append(((dvl::string_matcher_routine*) n.r)->get_str());
+			return true;
+		case dvl::TYPE_CHARSET:
+			append(((dvl::charset_routine*) n.r)->get_def());
+			return true;
+		case dvl::TYPE_REGEX:
+		{
+			dvl::regex_routine *r = (dvl::regex_routine*) n.r;
+			append(r->get_reg().str());
+			sig += r->get_dfa() != nullptr ? L'd' : L'r';
+			return true;
+		}
+		case dvl::TYPE_DELIMITED:
+		{
+			dvl::delimited_routine *d = (dvl::delimited_routine*) n.r;
+			append(std::wstring{d->get_terminator(), d->get_escape()});
+			append(d->get_fail());
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// graph
+//
+
+constexpr dvl::pass_manager::graph::index dvl::pass_manager::graph::NONE;
+
+dvl::pass_manager::graph::graph(const grammar &g, const std::unordered_set<uint64_t> &kept):
+	root(g.root()),
+	names(g.get_names()),
+	kept(kept)
+{
+	nodes.reserve(g.size());
+	forward.reserve(g.size());
+
+	for(index i = 0; i < g.size(); i++)
+	{
+		const grammar::node &n = g.get(i);
+		grammar::edge_range e = g.edges(i);
+
+		nodes.push_back({n.r, n.id, n.policy, std::vector<index>(e.begin(), e.end())});
+		forward.push_back(i);
+	}
+}
+
+bool
+dvl::pass_manager::graph::removable(index i)
+	const
+{
+	const node &n = nodes[i];
+
+	return n.policy == output_policy::TRANSPARENT ||
+			(n.policy == output_policy::EMIT && kept.find(n.id) == kept.end());
+}
+
+bool
+dvl::pass_manager::graph::redirect(index from, index to)
+{
+	to = resolve(to);
+
+	if(to == NONE || to == from || forward[from] != from)
+		return false;
+
+	forward[from] = to;
+
+	return true;
+}
+
+dvl::pass_manager::graph::index
+dvl::pass_manager::graph::add(const node &n)
+{
+	nodes.push_back(n);
+	forward.push_back(nodes.size() - 1);
+
+	return nodes.size() - 1;
+}
+
+std::vector<dvl::pass_manager::graph::index>
+dvl::pass_manager::graph::reachable()
+	const
+{
+	std::vector<index> order;
+	std::vector<bool> seen(nodes.size(), false);
+
+	auto visit = [&](index start){
+		start = resolve(start);
+		if(seen[start])
+			return;
+
+		seen[start] = true;
+		order.push_back(start);
+
+		for(std::size_t i = order.size() - 1; i < order.size(); i++)
+			for(std::size_t e = 0; e < nodes[order[i]].edges.size(); e++)
+			{
+				index s = edge(order[i], e);
+
+				if(s != NONE && !seen[s])
+				{
+					seen[s] = true;
+					order.push_back(s);
+				}
+			}
+	};
+
+	visit(root);
+
+	for(auto &n : names)
+		visit(n.second);
+
+	return order;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// pass_manager
+//
+
+dvl::pass_manager&
+dvl::pass_manager::keep(const pid &id)
+{
+	kept.insert(id);
+
+	return *this;
+}
+
+void
+dvl::pass_manager::register_pass(std::string name, pass p)
+{
+	passes.emplace_back(name, p);
+}
+
+dvl::routine*
+dvl::pass_manager::copy_node(const graph::node &n)
+{
+	routine *c;
+
+	switch(n.id.get_type())
+	{
+	case TYPE_FORK:
+		c = new fork_routine(n.id, std::vector<routine*>());
+		break;
+	case TYPE_SEQUENCE:
+		c = new sequence_routine(n.id, std::vector<routine*>());
+		break;
+	case TYPE_PREDICATE:
+		c = new predicate_routine(n.id, nullptr, ((predicate_routine*) n.r)->is_negated());
+		break;
+	case TYPE_LOOP:
+	{
+		loop_routine *l = (loop_routine*) n.r,
+				*lc = new loop_routine(n.id, nullptr, l->get_min_iterations(), l->get_max_iterations());
+
+		lc->set_helper_policy(l->get_helper_policy());
+		c = lc;
+		break;
+	}
+	default:
+		c = new struct_routine(n.id, nullptr, nullptr);
+		break;
+	}
+
+	c->set_output_policy(n.policy);
+	b.routines.insert(c);
+
+	return c;
+}
+
+dvl::grammar
+dvl::pass_manager::run(const grammar &gr, pid_table &pt)
+	throw(parser_exception)
+{
+	typedef graph::index index;
+
+	report.clear();
+
+	graph g(gr, kept);
+
+	for(auto &p : passes)
+	{
+		std::size_t before = g.reachable().size();
+		p.second(g);
+		report.push_back({p.first, before, g.reachable().size()});
+	}
+
+	// allocate the rewritten routines, then link them
+	std::vector<index> reach = g.reachable();
+	std::vector<routine*> out(g.size(), nullptr);
+
+	for(index i : reach)
+	{
+		uint8_t type = g.get(i).id.get_type();
+
+		if(type == TYPE_FORK || type == TYPE_SEQUENCE || type == TYPE_LOOP || type == TYPE_PREDICATE ||
+				type == TYPE_STRUCT)
+			out[i] = copy_node(g.get(i));
+		else
+			out[i] = g.get(i).r;
+	}
+
+	for(index i : reach)
+	{
+		auto sub = [&](std::size_t e){
+			index s = g.edge(i, e);
+			return s == graph::NONE ? nullptr : out[s];
+		};
+
+		switch(g.get(i).id.get_type())
+		{
+		case TYPE_FORK:
+			for(std::size_t e = 0; e < g.get(i).edges.size(); e++)
+				((fork_routine*) out[i])->add_fork(sub(e));
+			break;
+		case TYPE_SEQUENCE:
+			for(std::size_t e = 0; e < g.get(i).edges.size(); e++)
+				((sequence_routine*) out[i])->add_element(sub(e));
+			break;
+		case TYPE_LOOP:
+			((loop_routine*) out[i])->set_loop(sub(0));
+			break;
+		case TYPE_PREDICATE:
+			((predicate_routine*) out[i])->set_child(sub(0));
+			break;
+		case TYPE_STRUCT:
+			((struct_routine*) out[i])->set_child(sub(0));
+			((struct_routine*) out[i])->set_next(sub(1));
+			break;
+		default:
+			break;
+		}
+	}
+
+	std::vector<std::pair<std::wstring, routine*>> named;
+	for(auto &n : g.names)
+		named.emplace_back(n.first, out[g.resolve(n.second)]);
+
+	b.root = out[g.resolve(g.root)];
+	for(auto &n : named)
+		b.name_table[n.first] = n.second;
+
+	return b.freeze(b.root, named, pt);
+}
+
+void
+dvl::pass_manager::default_config(pass_manager &pm)
+{
+	pm.register_pass("inline-wrappers", &inline_wrappers);
+	pm.register_pass("flatten-chains", &flatten_chains);
+	pm.register_pass("fork-of-one", &eliminate_single_forks);
+	pm.register_pass("build-sequences", &build_sequences);
+	pm.register_pass("hash-consing", &merge_duplicates);
+}
+
+void
+dvl::pass_manager::inline_wrappers(graph &g)
+{
+	for(graph::index i : g.reachable())
+	{
+		if(g.get(i).id.get_type() != TYPE_STRUCT || !g.removable(i))
+			continue;
+
+		graph::index c = g.edge(i, 0), n = g.edge(i, 1);
+
+		if((c == graph::NONE) != (n == graph::NONE))
+			g.redirect(i, c == graph::NONE ? n : c);
+	}
+}
+
+void
+dvl::pass_manager::flatten_chains(graph &g)
+{
+	for(graph::index i : g.reachable())
+	{
+		if(g.get(i).id.get_type() != TYPE_STRUCT || !g.removable(i))
+			continue;
+
+		graph::index c = g.edge(i, 0), n = g.edge(i, 1);
+
+		if(c == graph::NONE || n == graph::NONE || c == i ||
+				g.get(c).id.get_type() != TYPE_STRUCT || g.edge(c, 1) != graph::NONE)
+			continue;
+
+		// the child continues with the next-routine in place of i
+		graph::node flat = g.get(c);
+		flat.edges[1] = n;
+
+		g.redirect(i, g.add(flat));
+	}
+}
+
+void
+dvl::pass_manager::build_sequences(graph &g)
+{
+	for(graph::index i : g.reachable())
+	{
+		auto link = [&g](graph::index j){
+			return g.get(j).id.get_type() == TYPE_STRUCT && g.resolve(j) == j && g.removable(j) &&
+					g.edge(j, 0) != graph::NONE && g.edge(j, 1) != graph::NONE;
+		};
+
+		if(!link(i))
+			continue;
+
+		// collect the children of the chain starting at i, the first routine that isn't
+		// part of the chain becomes the last element
+		std::vector<graph::index> chain;
+		graph::node seq{g.get(i).r, {g.get(i).id.get_group(), g.get(i).id.get_element(), TYPE_SEQUENCE},
+			output_policy::TRANSPARENT, {}};
+
+		graph::index j = i;
+		for(; link(j) && std::find(chain.begin(), chain.end(), j) == chain.end(); j = g.edge(j, 1))
+		{
+			chain.push_back(j);
+			seq.edges.push_back(g.edge(j, 0));
+		}
+
+		seq.edges.push_back(j);
+
+		// a single link isn't worth a sequence
+		if(chain.size() < 2)
+			continue;
+
+		g.redirect(i, g.add(seq));
+	}
+}
+
+void
+dvl::pass_manager::eliminate_single_forks(graph &g)
+{
+	for(graph::index i : g.reachable())
+		if(g.get(i).id.get_type() == TYPE_FORK && g.get(i).edges.size() == 1 && g.removable(i))
+			g.redirect(i, g.edge(i, 0));
+}
+
+void
+dvl::pass_manager::merge_duplicates(graph &g)
+{
+	// merging nodes may render their parents identical, repeat until no more nodes are merged
+	for(bool merged = true; merged;)
+	{
+		merged = false;
+
+		std::map<std::pair<std::wstring, std::vector<graph::index>>, graph::index> table;
+
+		for(graph::index i : g.reachable())
+		{
+			std::pair<std::wstring, std::vector<graph::index>> key;
+
+			if(g.resolve(i) != i || !signature(g.get(i), key.first))
+				continue;
+
+			for(std::size_t e = 0; e < g.get(i).edges.size(); e++)
+				key.second.push_back(g.edge(i, e));
+
+			auto it = table.emplace(key, i);
+			if(!it.second && g.redirect(i, it.first->second))
+				merged = true;
+		}
+	}
+}
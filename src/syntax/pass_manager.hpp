@@ -0,0 +1,227 @@
+#ifndef SYNTAX_PASS_MANAGER_HPP_
+#define SYNTAX_PASS_MANAGER_HPP_
+
+#include "../ex.hpp"
+#include "../id/pid.hpp"
+#include "routines.hpp"
+#include "grammar.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace dvl
+{
+	/////////////////////////////////////////////////////////////////////////////////
+	// pass_manager
+	//
+
+	/**
+	 * Rewrites a grammar via a pipeline of semantics-preserving passes. The input accepted by
+	 * the grammar remains unchanged, the output only differs in nodes whose pid wasn't
+	 * requested via keep(const pid&).
+	 *
+	 * A node may be removed by a pass, if its output isn't observable: its policy is
+	 * TRANSPARENT or its policy is EMIT and its pid isn't kept. SILENT nodes are never removed,
+	 * since they hide the output of their children.
+	 *
+	 * The default pipeline (see default_config) consists of the following passes:
+	 * <ul>
+	 * 	<li>inline-wrappers: structs with either only a child or only a next are replaced
+	 * 		by that routine</li>
+	 * 	<li>flatten-chains: a struct whose child is a struct without next is replaced by a
+	 * 		copy of the child, which continues with the next of the replaced struct</li>
+	 * 	<li>fork-of-one: forks with a single alternative are replaced by the alternative</li>
+	 * 	<li>build-sequences: chains of at least two structs linked via next are replaced by a
+	 * 		transparent sequence_routine of their children</li>
+	 * 	<li>hash-consing: structurally identical routines are merged</li>
+	 * </ul>
+	 *
+	 * Forks, sequences, loops, predicates and structs of the result are allocated anew in the
+	 * builder of the grammar, all other routines are shared with the input. Afterwards the root
+	 * and the named routines of the builder refer to the optimized graph, thus parsers created
+	 * from the builder use it. Shared routines are renumbered, which invalidates the numbering
+	 * of the input grammar.
+	 *
+	 * @see grammar
+	 * @see routine_tree_builder::freeze
+	 */
+	class pass_manager
+	{
+	public:
+		/**
+		 * Mutable copy of the routine-graph of a grammar operated on by the passes. Nodes are
+		 * never deleted, instead all references to a node are redirected to another node.
+		 * Thus the subroutines of a node must always be retrieved via edge(index, std::size_t).
+		 */
+		class graph
+		{
+			friend class pass_manager;
+		public:
+			typedef grammar::index index;
+
+			static constexpr index NONE = grammar::NONE;
+
+			struct node
+			{
+				/**
+				 * the routine providing the parameters of the node
+				 */
+				routine *r;
+
+				pid id;
+
+				output_policy policy;
+
+				/**
+				 * subroutines as described in grammar, prior to redirection
+				 */
+				std::vector<index> edges;
+			};
+		private:
+			std::vector<node> nodes;
+
+			/**
+			 * target of the redirection of each node, the node itself if not redirected
+			 */
+			std::vector<index> forward;
+
+			index root;
+
+			std::vector<std::pair<std::wstring, index>> names;
+
+			const std::unordered_set<uint64_t> &kept;
+
+			graph(const grammar &g, const std::unordered_set<uint64_t> &kept);
+		public:
+			std::size_t size() const { return nodes.size(); }
+
+			const node &get(index i) const { return nodes[i]; }
+
+			/**
+			 * @return the node replacing i or i itself, if it wasn't redirected
+			 */
+			index resolve(index i) const
+			{
+				while(i != NONE && forward[i] != i)
+					i = forward[i];
+
+				return i;
+			}
+
+			/**
+			 * @return the node referenced by the e-th edge of i or NONE
+			 */
+			index edge(index i, std::size_t e) const { return resolve(nodes[i].edges[e]); }
+
+			/**
+			 * @return true, if the output of the node isn't observable
+			 */
+			bool removable(index i) const;
+
+			/**
+			 * Redirects all references to from to the node to. Redirections that would
+			 * result in a cycle are rejected.
+			 *
+			 * @return true if the redirection was applied
+			 */
+			bool redirect(index from, index to);
+
+			/**
+			 * Appends a new node to the graph
+			 *
+			 * @return the index of the node
+			 */
+			index add(const node &n);
+
+			/**
+			 * @return all nodes reachable from the root and the named nodes in breadth-first order
+			 */
+			std::vector<index> reachable() const;
+		};
+
+		typedef std::function<void(graph&)> pass;
+
+		/**
+		 * Result of a single pass
+		 */
+		struct report_entry
+		{
+			std::string pass;
+
+			/**
+			 * number of reachable nodes before and after the pass
+			 */
+			std::size_t before, after;
+
+			std::size_t removed() const { return before - after; }
+		};
+	private:
+		routine_tree_builder &b;
+
+		std::vector<std::pair<std::string, pass>> passes;
+
+		std::unordered_set<uint64_t> kept;
+
+		std::vector<report_entry> report;
+
+		/**
+		 * allocates a copy of the fork, sequence, loop, predicate or struct n in the builder without subroutines
+		 */
+		routine *copy_node(const graph::node &n);
+	public:
+		/**
+		 * @param b the builder owning the grammars to optimize
+		 */
+		pass_manager(routine_tree_builder &b): b(b){}
+
+		/**
+		 * Requests nodes with the specified pid to remain in the output
+		 */
+		pass_manager &keep(const pid &id);
+
+		/**
+		 * Appends a pass to the pipeline
+		 *
+		 * @param name the name of the pass in the report
+		 * @param p the pass
+		 */
+		void register_pass(std::string name, pass p);
+
+		/**
+		 * Runs all passes in order of registration on the grammar and installs the result
+		 * in the builder.
+		 *
+		 * @param g a grammar frozen from the builder of this pass_manager
+		 * @param pt the table used to resolve the names of pids
+		 * @return the optimized grammar
+		 * @throws parser_exception if the optimized grammar is invalid
+		 */
+		grammar run(const grammar &g, pid_table &pt) throw(parser_exception);
+
+		/**
+		 * @return one entry per pass of the last run
+		 */
+		const std::vector<report_entry> &get_report() const { return report; }
+
+		/**
+		 * Registers the default pipeline
+		 */
+		static void default_config(pass_manager &pm);
+
+		static void inline_wrappers(graph &g);
+
+		static void flatten_chains(graph &g);
+
+		static void eliminate_single_forks(graph &g);
+
+		static void build_sequences(graph &g);
+
+		static void merge_duplicates(graph &g);
+	};
+}
+
+#endif /* SYNTAX_PASS_MANAGER_HPP_ */
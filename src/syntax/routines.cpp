@@ -1,4 +1,5 @@
 #include "routines.hpp"
+#include "grammar.hpp"
 
 /////////////////////////////////////////////////////////////////////////////////
 // charset_routine
@@ -221,7 +222,7 @@ dvl::charset_routine::init_matcher(charset_routine &r)
 		throw parser_exception(r.get_pid(), "Range out of order");
 
 	// function
-	r.matcher = [&, single, cr](wchar_t c)->bool{
+	r.matcher = [single, cr, inverted](wchar_t c)->bool{
 		return (single.find(c) != single.end() ||
 				std::find_if(cr.begin(), cr.end(), [c](auto v)->bool{
 					return v.first <= c && c <= v.second;
@@ -325,10 +326,12 @@ dvl::routine_tree_builder::insert_node(routine *rn)
 		case insertion_mode::NONE:
 			throw parser_exception(PARSER, "No insertion-mode specified");
 		case AS_CHILD:
-			if(r->get_pid().get_type() != TYPE_STRUCT)
+			if(r->get_pid().get_type() == TYPE_PREDICATE)
+				((predicate_routine*) r)->set_child(rn);
+			else if(r->get_pid().get_type() == TYPE_STRUCT)
+				((struct_routine*) r)->set_child(rn);
+			else
 				throw parser_exception(PARSER, parser_exception::ptree_builder_invalid_routine());
-
-			((struct_routine*) r)->set_child(rn);
 			break;
 		case insertion_mode::AS_NEXT:
 			if(r->get_pid().get_type() != TYPE_STRUCT)
@@ -342,6 +345,12 @@ dvl::routine_tree_builder::insert_node(routine *rn)
 
 			((fork_routine*) r)->add_fork(rn);
 			break;
+		case insertion_mode::AS_ELEMENT:
+			if(r->get_pid().get_type() != TYPE_SEQUENCE)
+				throw parser_exception(PARSER, parser_exception::ptree_builder_invalid_routine());
+
+			((sequence_routine*) r)->add_element(rn);
+			break;
 		case insertion_mode::AS_LOOP:
 			if(r->get_pid().get_type() != TYPE_LOOP)
 				throw parser_exception(PARSER, parser_exception::ptree_builder_invalid_routine());
@@ -454,6 +463,17 @@ dvl::routine_tree_builder::fork(pid id)
 	return *this;
 }
 
+dvl::routine_tree_builder&
+dvl::routine_tree_builder::sequence(pid id)
+{
+	routine *rn = new sequence_routine(id, std::vector<routine*>());
+	insert_node(rn);
+
+	ins_mode = insertion_mode::AS_ELEMENT;
+	r = rn;
+	return *this;
+}
+
 dvl::routine_tree_builder&
 dvl::routine_tree_builder::logic(pid id)
 {
@@ -465,6 +485,17 @@ dvl::routine_tree_builder::logic(pid id)
 	return *this;
 }
 
+dvl::routine_tree_builder&
+dvl::routine_tree_builder::predicate(pid id, bool negated)
+{
+	routine *rn = new predicate_routine(id, nullptr, negated);
+	insert_node(rn);
+
+	ins_mode = insertion_mode::AS_CHILD;
+	r = rn;
+	return *this;
+}
+
 dvl::routine_tree_builder&
 dvl::routine_tree_builder::by_ptr(routine *r)
 {
@@ -528,6 +559,107 @@ dvl::routine_tree_builder::finalize(std::wstring name)
 	return *this;
 }
 
+dvl::grammar
+dvl::routine_tree_builder::freeze(pid_table &pt)
+	throw(parser_exception)
+{
+	if(root == nullptr)
+		throw parser_exception(PARSER, "No root specified");
+
+	return freeze(root, std::vector<std::pair<std::wstring, routine*>>(name_table.begin(), name_table.end()), pt);
+}
+
+dvl::grammar
+dvl::routine_tree_builder::freeze(routine *start, const std::vector<std::pair<std::wstring, routine*>> &named,
+		pid_table &pt)
+	throw(parser_exception)
+{
+	std::vector<routine*> order;
+	std::set<routine*> seen;
+	std::vector<routine*> sub;
+
+	// breadth-first from the root, followed by unreachable named routines
+	auto layout = [&](routine *from){
+		if(!seen.insert(from).second)
+			return;
+
+		order.push_back(from);
+
+		for(std::size_t i = order.size() - 1; i < order.size(); i++)
+		{
+			routine *rn = order[i];
+			pid id = rn->get_pid();
+
+			sub.clear();
+			grammar::subroutines(rn, sub);
+
+			if(id.get_type() == TYPE_FORK && sub.empty())
+				throw parser_exception(id, "Fork without alternatives");
+			else if(id.get_type() == TYPE_STRUCT && sub[0] == nullptr && sub[1] == nullptr)
+				throw parser_exception(id, "Struct without child and next (undefined declaration?)");
+
+			for(routine *s : sub)
+				if(s == nullptr)
+				{
+					if(id.get_type() != TYPE_STRUCT)
+						throw parser_exception(id, "Missing subroutine");
+				}
+				else if(seen.insert(s).second)
+					order.push_back(s);
+		}
+	};
+
+	layout(start);
+
+	for(auto &n : named)
+		layout(n.second);
+
+	finalized.insert(order.begin(), order.end());
+
+	return grammar(order, named, pt);
+}
+
+dvl::routine_tree_builder&
+dvl::routine_tree_builder::set_output_policy(output_policy p)
+	throw(parser_exception)
+{
+	if(r == nullptr)
+		throw parser_exception(PARSER, "No current routine");
+	else if(finalized.find(r) != finalized.end())
+		throw parser_exception(PARSER, "Routine is marked as non-modifiable");
+
+	r->set_output_policy(p);
+
+	return *this;
+}
+
+dvl::routine_tree_builder&
+dvl::routine_tree_builder::set_output_policy(pid id, output_policy p)
+{
+	// applies to finalized routines as well, since the structure remains unchanged
+	for(routine *rn : routines)
+		if(rn->get_pid() == id)
+			rn->set_output_policy(p);
+
+	return *this;
+}
+
+dvl::routine_tree_builder&
+dvl::routine_tree_builder::set_helper_policy(output_policy p)
+	throw(parser_exception)
+{
+	if(r == nullptr)
+		throw parser_exception(PARSER, "No current routine");
+	else if(finalized.find(r) != finalized.end())
+		throw parser_exception(PARSER, "Routine is marked as non-modifiable");
+	else if(r->get_pid().get_type() != TYPE_LOOP)
+		throw parser_exception(PARSER, parser_exception::ptree_builder_invalid_routine());
+
+	((loop_routine*) r)->set_helper_policy(p);
+
+	return *this;
+}
+
 dvl::routine_tree_builder&
 dvl::routine_tree_builder::match_string(pid id, std::wstring match)
 {
@@ -552,6 +684,30 @@ dvl::routine_tree_builder::match_set(pid id, std::wstring set_def)
 	return *this;
 }
 
+dvl::routine_tree_builder&
+dvl::routine_tree_builder::match_regex(pid id, std::wstring reg)
+{
+	routine *rn = new regex_routine(id, reg);
+	insert_node(rn);
+
+	ins_mode = insertion_mode::NONE;
+	r = rn;
+
+	return *this;
+}
+
+dvl::routine_tree_builder&
+dvl::routine_tree_builder::match_delimited(pid id, wchar_t terminator, wchar_t escape, std::wstring fail)
+{
+	routine *rn = new delimited_routine(id, terminator, escape, fail);
+	insert_node(rn);
+
+	ins_mode = insertion_mode::NONE;
+	r = rn;
+
+	return *this;
+}
+
 dvl::routine_tree_builder&
 dvl::routine_tree_builder::lambda(pid id, lambda_routine::p_func f)
 {
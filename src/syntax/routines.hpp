@@ -4,14 +4,43 @@
 #include "../ex.hpp"
 #include "../id/pid.hpp"
 #include "../outp/lnstruct.hpp"
+#include "lazy_dfa.hpp"
 
 #include <stack>
 #include <set>
 #include <iostream>
+#include <memory>
 #include <boost/regex.hpp>
 
 namespace dvl
 {
+	class grammar;
+	class pass_manager;
+
+	////////////////////////////////////////////////////////////////////////////
+	// output policy
+	//
+
+	/**
+	 * Determines how the output of a routine is placed by the parser.
+	 *
+	 * <ul>
+	 * 	<li>EMIT: the node of the routine is placed in the output (default)</li>
+	 * 	<li>TRANSPARENT: the node of the routine is omitted, its children are placed
+	 * 		in its position</li>
+	 * 	<li>SILENT: neither the node of the routine nor any of its children are placed</li>
+	 * </ul>
+	 *
+	 * @see routine::set_output_policy(output_policy)
+	 * @see routine_tree_builder::set_output_policy(output_policy)
+	 */
+	enum class output_policy
+	{
+		EMIT,
+		TRANSPARENT,
+		SILENT
+	};
+
 	////////////////////////////////////////////////////////////////////////////
 	// routine interface
 	//
@@ -35,11 +64,38 @@ namespace dvl
 		 * The pid of the routine
 		 */
 		pid id;
+
+		/**
+		 * Placement of the output of this routine
+		 */
+		output_policy policy = output_policy::EMIT;
+
+		/**
+		 * Dense index of this routine within its grammar
+		 */
+		std::size_t index = NO_INDEX;
 	public:
+		/**
+		 * Index of routines that weren't numbered
+		 */
+		static const std::size_t NO_INDEX = ~(std::size_t) 0;
+
 		routine(pid id): id(id){}
 		virtual ~routine(){};
 
 		const pid& get_pid(){ return id; }
+
+		output_policy get_output_policy() const { return policy; }
+
+		void set_output_policy(output_policy p){ policy = p; }
+
+		/**
+		 * @return the dense index of this routine or NO_INDEX
+		 * @see grammar_index
+		 */
+		std::size_t get_index() const { return index; }
+
+		void set_index(std::size_t i){ index = i; }
 	};
 
 	////////////////////////////////////////////////////////////////////////////
@@ -91,6 +147,37 @@ namespace dvl
 		std::vector<routine*>& forks(){ return fork; }
 	};
 
+	////////////////////////////////////////////////////////////////////////////
+	// sequence_routine
+	//
+
+	/**
+	 * Defines a sequence of structures that must occur in the given order. The output of
+	 * the elements is placed as children of the node of the sequence. In contrast to a chain of
+	 * struct_routines linked via next, the parser runs all elements from a single routine.
+	 */
+	class sequence_routine : public routine
+	{
+	private:
+		std::vector<routine*> seq;
+	public:
+		sequence_routine(pid id, std::vector<routine*> elements):
+			routine(id),
+			seq(elements){
+			if(id.get_type() != TYPE_SEQUENCE)
+				throw parser_exception(PARSER, parser_exception::invalid_pid("sequence_routine"));
+		}
+
+		/**
+		 * Appends a new element to this routine
+		 *
+		 * @see routine_tree_builder
+		 */
+		void add_element(routine *r){ seq.emplace_back(r); }
+
+		std::vector<routine*>& elements(){ return seq; }
+	};
+
 	////////////////////////////////////////////////////////////////////////////
 	// loop_routine
 	//
@@ -116,6 +203,11 @@ namespace dvl
 		 * The routine that will be looped.
 		 */
 		routine *loop;
+
+		/**
+		 * Placement of the LOOP_HELPER-node wrapping the output of each iteration
+		 */
+		output_policy helper_policy = output_policy::EMIT;
 	public:
 		loop_routine(pid id, routine *loop, unsigned int min_iterations = 0, unsigned int max_iterations = _INFINITY):
 		 	routine(id),
@@ -172,6 +264,26 @@ namespace dvl
 		 * @see INFINITY
 		 */
 		unsigned int get_max_iterations(){ return max_iterations; }
+
+		/**
+		 * Sets the placement of the LOOP_HELPER-nodes wrapping the output of each
+		 * iteration. If set to TRANSPARENT, the output of the iterations will be placed
+		 * directly as children of the loop. SILENT isn't supported, use SILENT on
+		 * the looped routine instead.
+		 *
+		 * @param p the new policy
+		 * @throws parser_exception if p is SILENT
+		 */
+		void set_helper_policy(output_policy p)
+			throw(parser_exception)
+		{
+			if(p == output_policy::SILENT)
+				throw parser_exception(get_pid(), "LOOP_HELPER-nodes can't be silent");
+
+			helper_policy = p;
+		}
+
+		output_policy get_helper_policy() const { return helper_policy; }
 	};
 
 	////////////////////////////////////////////////////////////////////////////
@@ -240,6 +352,45 @@ namespace dvl
 		routine* get_next(){ return n; }
 	};
 
+	////////////////////////////////////////////////////////////////////////////
+	// predicate_routine
+	//
+
+	/**
+	 * Lookahead-predicate: succeeds if the child matches (&p) or if it doesn't match (!p)
+	 * at the current position. The input is never consumed and the predicate produces no
+	 * output. The child is only run to recognize the input, thus neither its output is
+	 * placed, nor are its nodes reported to listeners.
+	 */
+	class predicate_routine : public routine
+	{
+	private:
+		routine *c;
+
+		bool negated;
+	public:
+		/**
+		 * @param id the pid of the routine
+		 * @param child the routine to look ahead for
+		 * @param negated true for a negative lookahead (!p)
+		 * @throws parser_exception if an invalid pid was passed
+		 */
+		predicate_routine(pid id, routine *child, bool negated = false):
+			routine(id), c(child), negated(negated){
+			if(id.get_type() != TYPE_PREDICATE)
+				throw parser_exception(PARSER, parser_exception::invalid_pid("predicate_routine"));
+		}
+
+		void set_child(routine *child){ c = child; }
+
+		routine *get_child(){ return c; }
+
+		/**
+		 * @return true if the predicate succeeds if the child doesn't match
+		 */
+		bool is_negated() const { return negated; }
+	};
+
 	////////////////////////////////////////////////////////////////////////////
 	// echo routine
 	//
@@ -350,9 +501,25 @@ namespace dvl
 	 */
 	class stack_trace_routine : public routine
 	{
+	private:
+		/**
+		 * The stream the stack-trace is printed to
+		 */
+		std::wostream &str;
 	public:
-		stack_trace_routine():
-			routine(STACK_TRACE){}
+		/**
+		 * @param str the stream to print to
+		 */
+		stack_trace_routine(std::wostream &str = std::wcout):
+			routine(STACK_TRACE), str(str){}
+
+		/**
+		 * Getter for the stream to which the stack-trace is printed
+		 *
+		 * @return the stream to print to
+		 * @see str
+		 */
+		std::wostream& get_stream(){ return str; }
 	};
 
 	////////////////////////////////////////////////////////////////////////////////////
@@ -477,6 +644,11 @@ namespace dvl
 		 */
 		std::function<bool(wchar_t)>& get_matcher(){ return matcher; }
 
+		/**
+		 * @return the definition of this charset as plain text
+		 */
+		const std::wstring &get_def() const { return def; }
+
 		/**
 		 * Getter for the number of minimum-repetitions.
 		 *
@@ -501,13 +673,18 @@ namespace dvl
 	//
 
 	/**
-	 * <em>For future use! At the moment this class is not used by the implementation. </em>
-	 *
 	 * Routine that matches the stream starting from the given position against the
 	 * specified regex. The regex must match starting from the current posiion of the
-	 * input-stream in order for the routine to succeed.
+	 * input-stream in order for the routine to succeed. The routine consumes the longest
+	 * prefix of the input matched by the regex (leftmost-longest semantics).
+	 *
+	 * Patterns only using features supported by @link lazy_dfa will be matched by a lazy dfa,
+	 * which matches in linear time without backtracking or allocating memory. Any other
+	 * pattern (e.g. using backreferences) falls back to boost::wregex. The dfa isn't modified
+	 * while matching, each parser generates the states of the dfa in its own cache.
 	 *
 	 * @see TYPE_REGEX
+	 * @see lazy_dfa
 	 */
 	class regex_routine : public routine
 	{
@@ -518,17 +695,39 @@ namespace dvl
 		 * @see get_reg()
 		 */
 		boost::wregex reg;
+
+		/**
+		 * The dfa used to match the regex or nullptr, if the regex uses features not supported
+		 * by lazy_dfa
+		 *
+		 * @see get_dfa()
+		 */
+		std::unique_ptr<lazy_dfa> dfa;
 	public:
 		/**
 		 * Constructs a new regex_routine for the given regex (@p reg) and
 		 * with the specified pid.
+		 *
+		 * @param id the pid of the routine
+		 * @param reg the regex to match
+		 * @param use_dfa if false, the regex will always be matched by boost::wregex
+		 * @throws parser_exception if the pid is invalid
 		 */
-		regex_routine(pid id, std::wstring reg):
+		regex_routine(pid id, std::wstring reg, bool use_dfa = true)
+			throw(parser_exception):
 			routine(id),
 			reg(reg)
 		{
 			if(id.get_type() != TYPE_REGEX)
 				throw parser_exception(id, parser_exception::invalid_pid("regex_routine"));
+
+			if(use_dfa)
+				try{
+					dfa.reset(new lazy_dfa(id, reg));
+				}catch(const parser_exception &e)
+				{
+					// unsupported by the dfa, fall back to boost
+				}
 		}
 
 		/**
@@ -538,6 +737,94 @@ namespace dvl
 		 * @see reg
 		 */
 		const boost::wregex& get_reg(){ return reg; }
+
+		/**
+		 * Getter for the dfa of this routine
+		 *
+		 * @return the dfa used to match the regex or nullptr, if boost::wregex is used
+		 * @see dfa
+		 */
+		const lazy_dfa *get_dfa() const { return dfa.get(); }
+	};
+
+	/////////////////////////////////////////////////////////////////////////////////
+	// delimited-routine
+	//
+
+	/**
+	 * Matches arbitrary content up to the first unescaped terminator. The terminator itself
+	 * won't be consumed. Any character following the escape-character is considered escaped,
+	 * except for failure-characters. Encountering a failure-character (e.g. a newline for
+	 * single-line strings) or the end of the input before the terminator results in a
+	 * parser_exception.
+	 *
+	 * Neither the terminator nor the escape-character may be failure-characters and terminator
+	 * and escape-character must differ.
+	 *
+	 * @see TYPE_DELIMITED
+	 */
+	class delimited_routine : public routine
+	{
+	public:
+		/**
+		 * Escape-character signaling that the routine doesn't support escaping
+		 */
+		static const wchar_t NO_ESCAPE = L'\0';
+	private:
+		wchar_t terminator;
+		wchar_t escape;
+		std::wstring fail;
+
+		/**
+		 * all characters at which scanning needs to stop: terminator, escape and
+		 * failure-characters
+		 */
+		std::wstring stops;
+	public:
+		/**
+		 * Constructs a new delimited_routine
+		 *
+		 * @param id the pid of the routine
+		 * @param terminator the character terminating the content
+		 * @param escape the escape-character or NO_ESCAPE
+		 * @param fail characters that may not occur in the content
+		 * @throws parser_exception if the pid or the combination of characters is invalid
+		 */
+		delimited_routine(pid id, wchar_t terminator, wchar_t escape = L'\\', std::wstring fail = L"\n")
+			throw(parser_exception):
+			routine(id),
+			terminator(terminator),
+			escape(escape),
+			fail(fail),
+			stops(1, terminator)
+		{
+			if(id.get_type() != TYPE_DELIMITED)
+				throw parser_exception(id, parser_exception::invalid_pid("delimited_routine"));
+
+			if(terminator == escape || is_fail(terminator) || is_fail(escape))
+				throw parser_exception(id, "Invalid combination of terminator, escape- and failure-characters");
+
+			if(escape != NO_ESCAPE)
+				stops += escape;
+
+			stops += fail;
+		}
+
+		wchar_t get_terminator() const { return terminator; }
+
+		wchar_t get_escape() const { return escape; }
+
+		const std::wstring &get_fail() const { return fail; }
+
+		/**
+		 * @return the characters at which scanning needs to stop
+		 */
+		const std::wstring &get_stops() const { return stops; }
+
+		/**
+		 * @return true if c is a failure-character
+		 */
+		bool is_fail(wchar_t c) const { return fail.find(c) != std::wstring::npos; }
 	};
 
 	/////////////////////////////////////////////////////////////////////////////////
@@ -585,6 +872,8 @@ namespace dvl
 	 */
 	class routine_tree_builder
 	{
+		friend class grammar_index;
+		friend class pass_manager;
 	public:
 		/**
 		 * specifies the insertion-mode of new routines based on the type of the routine.
@@ -601,7 +890,8 @@ namespace dvl
 					AS_CHILD,
 					AS_NEXT,
 					AS_LOOP,
-					AS_FORK
+					AS_FORK,
+					AS_ELEMENT
 				};
 	private:
 		/**
@@ -667,11 +957,19 @@ namespace dvl
 		 */
 		std::set<routine*> finalized;
 
+		/**
+		 * Lays out the routines reachable from start and the named routines
+		 *
+		 * @see freeze(pid_table&)
+		 */
+		grammar freeze(routine *start, const std::vector<std::pair<std::wstring, routine*>> &named,
+				pid_table &pt) throw(parser_exception);
+
 		/**
 		 * Inserts the specified routine into the tree
 		 * in relation to the last routine r, as specified by
 		 * ins_mode. Used by loop(pid, unsigned int, unsigned int), fork(pid),
-		 * logic(pid) and by_ptr(routine*)
+		 * sequence(pid), logic(pid), predicate(pid, bool) and by_ptr(routine*)
 		 *
 		 * @param nr new routine to insert
 		 *
@@ -796,6 +1094,19 @@ namespace dvl
 		 */
 		routine_tree_builder& fork(pid id);
 
+		/**
+		 * Generates and inserts a new sequence-routine in the routine-tree and
+		 * stores it as the current routine. Subsequent insertions with insertion_mode
+		 * AS_ELEMENT append elements to the sequence.
+		 *
+		 * @param id the pid of the sequence-routine
+		 *
+		 * @see r
+		 * @see insert_node(routine*)
+		 * @see sequence_routine
+		 */
+		routine_tree_builder& sequence(pid id);
+
 		/**
 		 * Generates and inserts a new logic-routine in the routine-tree and
 		 * stores it as the current routine
@@ -808,6 +1119,20 @@ namespace dvl
 		 */
 		routine_tree_builder& logic(pid id);
 
+		/**
+		 * Generates and inserts a new predicate-routine in the routine-tree and
+		 * stores it as the current routine. The routine to look ahead for is inserted
+		 * with insertion_mode AS_CHILD.
+		 *
+		 * @param id the pid of the predicate-routine
+		 * @param negated true for a negative lookahead
+		 *
+		 * @see r
+		 * @see insert_node(routine*)
+		 * @see predicate_routine
+		 */
+		routine_tree_builder& predicate(pid id, bool negated = false);
+
 		/**
 		 * Inserts the specified routine by pointer and sets it as the current
 		 * routine. This allows inserting arbitrary (e.g. by the builder not supported)
@@ -870,6 +1195,61 @@ namespace dvl
 		 */
 		routine_tree_builder &finalize(std::wstring name) throw(parser_exception);
 
+		/**
+		 * Validates the routines reachable from the root and the named routines and produces
+		 * an immutable grammar from them. All routines of the grammar are marked as finalized
+		 * and numbered in the layout of the grammar.
+		 *
+		 * The following is considered invalid:
+		 * <ul>
+		 * 	<li>no root specified</li>
+		 * 	<li>forks without alternatives or with missing alternatives</li>
+		 * 	<li>sequences with missing elements</li>
+		 * 	<li>loops without a routine to loop over</li>
+		 * 	<li>predicates without a routine to look ahead for</li>
+		 * 	<li>structs with neither child nor next, e.g. a routine that was declared via
+		 * 		logic(pid) and name(std::wstring), but never defined</li>
+		 * </ul>
+		 *
+		 * @param pt the table used to resolve the names of pids
+		 * @return the grammar
+		 * @throws parser_exception if the routine-graph is invalid
+		 * @see grammar
+		 */
+		grammar freeze(pid_table &pt) throw(parser_exception);
+
+		/**
+		 * Sets the output_policy of the current routine
+		 *
+		 * @param p the new output_policy
+		 *
+		 * @see r
+		 * @see output_policy
+		 */
+		routine_tree_builder &set_output_policy(output_policy p) throw(parser_exception);
+
+		/**
+		 * Sets the output_policy of all routines with the specified pid, that were
+		 * built by this builder so far. The current routine remains unchanged.
+		 *
+		 * @param id the pid of the routines to update
+		 * @param p the new output_policy
+		 *
+		 * @see output_policy
+		 */
+		routine_tree_builder &set_output_policy(pid id, output_policy p);
+
+		/**
+		 * Sets the placement of the LOOP_HELPER-nodes of the current routine, which must
+		 * be a loop_routine
+		 *
+		 * @param p the new policy for LOOP_HELPER-nodes
+		 *
+		 * @see r
+		 * @see loop_routine::set_helper_policy(output_policy)
+		 */
+		routine_tree_builder &set_helper_policy(output_policy p) throw(parser_exception);
+
 		/**
 		 * Generates and inserts a new string_matcher_routine in the routine-graph
 		 * that will match the specified string (@p match)
@@ -895,6 +1275,34 @@ namespace dvl
 		 */
 		routine_tree_builder &match_set(pid id, std::wstring set_def);
 
+		/**
+		 * Generates and inserts a new regex_routine in the routine_graph.
+		 *
+		 * @param id the pid of the regex_routine
+		 * @param reg the regex to match
+		 *
+		 * @see r
+		 * @see insert_node(routine*)
+		 * @see regex_routine
+		 */
+		routine_tree_builder &match_regex(pid id, std::wstring reg);
+
+		/**
+		 * Generates and inserts a new delimited_routine in the routine-graph
+		 *
+		 * @param id the pid of the delimited_routine
+		 * @param terminator the character terminating the content
+		 * @param escape the escape-character or delimited_routine::NO_ESCAPE
+		 * @param fail characters that may not occur in the content
+		 * @return @c *this
+		 *
+		 * @see r
+		 * @see insert_node(routine*)
+		 * @see delimited_routine
+		 */
+		routine_tree_builder &match_delimited(pid id, wchar_t terminator, wchar_t escape = L'\\',
+				std::wstring fail = L"\n");
+
 		/**
 		 * Generates and inserts a new lambda-routine in the routine-graph.
 		 *
@@ -907,6 +1315,24 @@ namespace dvl
 		 * @see lambda_routine
 		 */
 		routine_tree_builder &lambda(pid id, lambda_routine::p_func f);
+
+		/**
+		 * Generates and inserts a new inline_routine in the routine-graph. In contrast to
+		 * lambda(pid, lambda_routine::p_func) the functor is stored with its static type
+		 * and called without any indirection.
+		 *
+		 * Defined in inline_routine.hpp, which must be included to use this method.
+		 *
+		 * @param id the pid of the inline_routine
+		 * @param f the functor implementing the routine
+		 * @return @c *this
+		 *
+		 * @see r
+		 * @see insert_node(routine*)
+		 * @see inline_routine
+		 */
+		template<typename F>
+		routine_tree_builder &scan(pid id, F f);
 	};
 }
 
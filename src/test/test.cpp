@@ -1,10 +1,29 @@
 #include "test.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <set>
+#include <thread>
 
 #include "../parser.hpp"
+#include "../syntax/inline_routine.hpp"
+#include "../syntax/grammar_index.hpp"
+#include "../syntax/grammar.hpp"
+#include "../syntax/pass_manager.hpp"
+#include "../outp/flat_tree.hpp"
+#include "../outp/event_stream.hpp"
+#include "../outp/binary_tree.hpp"
+#include "../outp/structure_writer.hpp"
+#include "../outp/text_view.hpp"
+#include "../outp/pid_index.hpp"
+#include "../outp/tree_stats.hpp"
 
 
 // compile with -D UNIT_TEST in order to enable unit-testing.
@@ -179,6 +198,10 @@ private:
 			*c = nullptr;
 
 	std::wistream &str;
+
+	std::wstring buffer;
+
+	std::map<const dvl::lazy_dfa*, dvl::lazy_dfa::cache> dfa_caches;
 public:
 	helper_routine_interface(std::wistream &str):
 		str(str){}
@@ -226,6 +249,36 @@ public:
 		return str;
 	}
 
+	dvl::input_cursor
+	get_cursor(){
+		std::wistringstream *ss = dynamic_cast<std::wistringstream*>(&str);
+		buffer = (ss != nullptr ? ss->str() : L"");
+
+		return dvl::input_cursor(buffer.data(), buffer.data() + buffer.size(), str.tellg());
+	}
+
+	void
+	commit(const dvl::input_cursor &c){
+		str.clear();
+		str.seekg(c.pos());
+	}
+
+	void
+	rewind(long pos){
+		str.clear();
+		str.seekg(pos);
+	}
+
+	dvl::lazy_dfa::cache&
+	get_dfa_cache(const dvl::lazy_dfa &dfa){
+		auto it = dfa_caches.find(&dfa);
+
+		if(it == dfa_caches.end())
+			it = dfa_caches.emplace(&dfa, dvl::lazy_dfa::cache(dfa)).first;
+
+		return it->second;
+	}
+
 	// helper interface
 
 	void throw_on_next_run(dvl::parser_exception e)
@@ -768,6 +821,279 @@ public:
 	}
 };
 
+class test_loop_routine_transparent_helper : public test_loop_routine
+{
+public:
+	test_loop_routine_transparent_helper():
+		test_loop_routine("test loop routine transparent helper", "Tests if the output of iterations"
+				" is chained directly, if the helper-nodes are transparent")
+	{
+		lr->set_helper_policy(dvl::output_policy::TRANSPARENT);
+		rebuild_plr();
+	}
+
+	void run_test()
+	{
+		assert_throws([this](){ lr->set_helper_policy(dvl::output_policy::SILENT); },
+				"Helper-nodes mustn't be silent");
+		assert_equal(plr->wraps_children(), false, "Transparent helper shouldn't be wrapped");
+
+		dvl::lnstruct *a = new dvl::lnstruct(dvl::EMPTY, 0l),
+				*b = new dvl::lnstruct(dvl::EMPTY, 0l);
+
+		plr->ri_run(ri);
+		plr->ri_place_child(a);
+		plr->ri_run(ri);
+		plr->ri_place_child(b);
+
+		std::unique_ptr<dvl::lnstruct> ln(plr->get_result());
+		assert_equal(ln->get_child(), a, "First iteration wasn't placed as child");
+		assert_equal(a->get_next(), b, "Iterations weren't chained");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// sequence-routine
+//
+
+class test_sequence_routine_normal_run : public test_routine
+{
+public:
+	test_sequence_routine_normal_run():
+		test_routine("test sequence routine normal run", "Tests if the sequence-routine runs its"
+				" elements in order and fails with the first failing element", std::wcin)
+	{}
+
+	void run_test()
+	{
+		dvl::empty_routine a, b, c;
+		dvl::sequence_routine sr({0l, 0l, dvl::TYPE_SEQUENCE}, {&a, &b, &c});
+
+		std::unique_ptr<proutine> psr(factory.build_routine(&sr));
+
+		dvl::lnstruct *la = new dvl::lnstruct(dvl::EMPTY, 0l),
+				*lb = new dvl::lnstruct(dvl::EMPTY, 0l);
+
+		psr->ri_run(ri);
+		assert_equal(ri.get_child(), (dvl::routine*) &a, "First element wasn't run");
+		psr->ri_place_child(la);
+
+		psr->ri_run(ri);
+		assert_equal(ri.get_child(), (dvl::routine*) &b, "Second element wasn't run");
+		psr->ri_place_child(lb);
+
+		psr->ri_run(ri);
+		assert_equal(ri.get_child(), (dvl::routine*) &c, "Last element wasn't run");
+		assert_equal(ri.get_repeat_count(), 2, "The last element shouldn't repeat the sequence");
+		assert_throws([&psr, this](){ psr->ri_run(ri); }, "Sequence mustn't run after the last element");
+
+		std::unique_ptr<dvl::lnstruct> ln(psr->get_result());
+		assert_equal(ln->get_child(), la, "First element wasn't placed as child");
+		assert_equal(la->get_next(), lb, "Elements weren't chained");
+
+		// failure of an element
+		std::unique_ptr<proutine> pf(factory.build_routine(&sr));
+		pf->ri_run(ri);
+		ri.throw_on_next_run(dvl::parser_exception(dvl::EMPTY, "failure"));
+		assert_throws([&pf, this](){ pf->ri_run(ri); }, "Failing element must fail the sequence");
+		delete pf->get_result();
+	}
+};
+
+class test_sequence_parse : public test
+{
+public:
+	test_sequence_parse():
+		test("sequence parse", "Tests if the parser runs sequences, rewinds them on failure and if"
+				" struct-chains are replaced by sequences without changing the output")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid l = {5l, 0l, dvl::TYPE_LOOP},
+				f = {5l, 1l, dvl::TYPE_FORK},
+				seq = {5l, 2l, dvl::TYPE_SEQUENCE},
+				anon = {5l, 3l, dvl::TYPE_STRUCT},
+				a = {5l, 4l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		auto parse = [&pt](dvl::routine_tree_builder &b, std::wstring in){
+			std::wistringstream str(in);
+			dvl::parser_context c(str, b, pt, factory);
+			dvl::flat_tree_builder fb;
+			c.listeners.push_back(&fb);
+
+			dvl::parser p(c);
+			p.run();
+			delete p.get_result();
+
+			return fb.get();
+		};
+
+		// loop -> fork(sequence(x, y), sequence(x, z))
+		dvl::routine_tree_builder b;
+		b.loop(l, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.fork(f).push_checkpoint().set_insertion_mode(im::AS_FORK)
+					.sequence(seq).push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+						.match_string(a, L"x").pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+						.match_string(a, L"y")
+				.pop_checkpoint().set_insertion_mode(im::AS_FORK)
+					.sequence(seq).push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+						.match_string(a, L"x").pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+						.match_string(a, L"z");
+
+		dvl::flat_tree t = parse(b, L"xzxy");
+
+		// loop, 2 x (helper, fork, sequence, 2 matchers)
+		assert_equal(t.size(), (std::size_t) 11, "Invalid number of nodes");
+		assert_equal(t.get_pid(3), seq, "Sequence wasn't emitted");
+		assert_equal(t.get_start(5), 1l, "Failed sequence wasn't rewound");
+		assert_equal(t.get_end(3), 2l, "Invalid end of sequence");
+
+		// chain of anonymous structs
+		dvl::routine_tree_builder c;
+		c.loop(l, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.logic(anon).push_checkpoint().set_insertion_mode(im::AS_CHILD)
+					.match_string(a, L"x").pop_checkpoint().set_insertion_mode(im::AS_NEXT)
+				.logic(anon).push_checkpoint().set_insertion_mode(im::AS_CHILD)
+					.match_string(a, L"y").pop_checkpoint().set_insertion_mode(im::AS_NEXT)
+				.match_string(a, L"z");
+
+		auto kept = [&a](const dvl::flat_tree &t){
+			std::vector<std::pair<long, long>> r;
+			for(dvl::flat_tree::index i = 0; i < t.size(); i++)
+				if(t.get_pid(i) == a)
+					r.emplace_back(t.get_start(i), t.get_end(i));
+
+			return r;
+		};
+
+		auto expected = kept(parse(c, L"xyzxyz"));
+
+		dvl::pass_manager pm(c);
+		pm.register_pass("build-sequences", &dvl::pass_manager::build_sequences);
+		pm.keep(a);
+
+		dvl::grammar g = pm.run(c.freeze(pt), pt);
+		assert_equal(pm.get_report()[0].removed(), (std::size_t) 1, "Chain wasn't replaced");
+		assert_equal(g.get(g.edges(g.root()).begin()[0]).id.get_type(), dvl::TYPE_SEQUENCE,
+				"Loop doesn't run a sequence");
+		assert_true(kept(parse(c, L"xyzxyz")) == expected, "Output of the sequence differs from the chain");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// predicate-routine
+//
+
+class test_predicate_routine : public test_routine
+{
+public:
+	test_predicate_routine():
+		test_routine("test predicate routine", "Tests if predicates never consume input and"
+				" succeed depending on the match of the child", std::wcin)
+	{}
+
+	void run_test()
+	{
+		dvl::empty_routine er;
+		dvl::predicate_routine pos({0l, 0l, dvl::TYPE_PREDICATE}, &er),
+				neg({0l, 1l, dvl::TYPE_PREDICATE}, &er, true);
+
+		std::wistringstream str(L"abc");
+		helper_routine_interface h(str);
+		str.seekg(1);
+
+		std::unique_ptr<proutine> p(factory.build_routine(&pos));
+		assert_true(p->recognizes_children(), "Output of the child must be discarded");
+
+		p->ri_run(h);
+		assert_equal(h.get_child(), (dvl::routine*) &er, "Child wasn't run");
+		p->ri_place_child(new dvl::lnstruct(dvl::EMPTY, 1l));
+
+		str.seekg(3);
+		assert_no_throw([&p, &h](){ p->ri_run(h); }, "Matching lookahead failed");
+		assert_equal((long) str.tellg(), 1l, "Lookahead consumed input");
+		assert_equal(p->get_result(), (dvl::lnstruct*) nullptr, "Predicate produced output");
+
+		// failing child
+		std::unique_ptr<proutine> pf(factory.build_routine(&pos)),
+				nf(factory.build_routine(&neg)),
+				nm(factory.build_routine(&neg));
+
+		pf->ri_run(h);
+		h.throw_on_next_run(dvl::parser_exception(dvl::EMPTY, "failure"));
+		assert_throws([&pf, &h](){ pf->ri_run(h); }, "Lookahead succeeded without match");
+
+		nf->ri_run(h);
+		h.throw_on_next_run(dvl::parser_exception(dvl::EMPTY, "failure"));
+		assert_no_throw([&nf, &h](){ nf->ri_run(h); }, "Negative lookahead failed without match");
+
+		nm->ri_run(h);
+		nm->ri_place_child(nullptr);
+		assert_throws([&nm, &h](){ nm->ri_run(h); }, "Negative lookahead succeeded on match");
+	}
+};
+
+class test_predicate_parse : public test
+{
+public:
+	test_predicate_parse():
+		test("predicate parse", "Tests if the output of predicates and their children is"
+				" neither placed nor reported")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid seq = {5l, 0l, dvl::TYPE_SEQUENCE},
+				pred = {5l, 1l, dvl::TYPE_PREDICATE},
+				x = {5l, 2l, dvl::TYPE_STRING_MATCHER},
+				word = {5l, 3l, dvl::TYPE_CHARSET};
+
+		dvl::pid_table pt;
+
+		// !"x" &"a" [a-z]*
+		dvl::routine_tree_builder b;
+		b.sequence(seq).mark_root().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.predicate(pred, true).match_string(x, L"x")
+				.pop_checkpoint().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.predicate(pred).match_string(x, L"a")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_set(word, L"[a-z]*");
+
+		dvl::flat_tree t;
+
+		// returns the number of placed nodes or -1, if the input didn't match
+		auto parse = [&](std::wstring in){
+			std::wistringstream str(in);
+			dvl::parser_context c(str, b, pt, factory);
+			dvl::flat_tree_builder fb;
+			c.listeners.push_back(&fb);
+
+			dvl::parser p(c);
+			p.run();
+
+			std::unique_ptr<dvl::lnstruct> ln(p.get_result());
+			t = fb.get();
+
+			return ln == nullptr ? -1 : ln->total_count();
+		};
+
+		assert_equal(parse(L"ab"), 2, "Predicates placed output");
+		assert_equal(t.size(), (std::size_t) 2, "Predicates reported output");
+		assert_equal(t.get_pid(1), word, "Invalid node after predicates");
+		assert_equal(t.get_start(1), 0l, "Predicates consumed input");
+
+		assert_equal(parse(L"xa"), -1, "Negative lookahead matched");
+		assert_equal(parse(L"ba"), -1, "Positive lookahead didn't match");
+	}
+};
+
 ///////////////////////////////////////////////////////////////////////////////////
 // logic-routine
 //
@@ -814,48 +1140,1742 @@ public:
 };
 
 ///////////////////////////////////////////////////////////////////////////////////
-// parser matcher routine
+// regex routine
+//
+
+class test_regex_routine : public test
+{
+protected:
+	dvl::pid id = {0l, 0l, dvl::TYPE_REGEX};
+
+	/**
+	 * Runs a regex_routine for reg on input and returns the stream-position
+	 * after the run
+	 */
+	long run_regex(dvl::regex_routine &r, std::wstring input)
+	{
+		std::wistringstream str(input);
+		helper_routine_interface h(str);
+
+		std::unique_ptr<proutine> p(factory.build_routine(&r));
+		p->ri_run(h);
+
+		assert_equal(p->get_result()->get_end(), (long) str.tellg(), "End of output doesn't match stream-position");
+
+		delete p->get_result();
+
+		return str.tellg();
+	}
+public:
+	test_regex_routine(std::string name, std::string description):
+		test(name, description)
+	{}
+};
+
+class test_regex_routine_dfa : public test_regex_routine
+{
+public:
+	test_regex_routine_dfa():
+		test_regex_routine("regex routine dfa", "Tests if simple regexes are matched by the dfa"
+				" using leftmost-longest semantics")
+	{}
+
+	void run_test()
+	{
+		dvl::regex_routine ident(id, L"[A-Za-z_][A-Za-z0-9_]*");
+		assert_not_equal(ident.get_dfa(), nullptr, "Simple regex should be matched by the dfa");
+		assert_equal(run_regex(ident, L"abc_1 def"), 5l, "Invalid match-length");
+		assert_throws([this, &ident](){ run_regex(ident, L"1abc"); }, "Mismatch should fail");
+
+		dvl::regex_routine alt(id, L"a|ab|(c\\.)+");
+		assert_equal(run_regex(alt, L"abab"), 2l, "Longest alternative should match");
+		assert_equal(run_regex(alt, L"c.c.c"), 4l, "Invalid repetition-match");
+
+		dvl::regex_routine bounded(id, L"x{2,3}");
+		assert_equal(run_regex(bounded, L"xxxx"), 3l, "Upper bound exceeded");
+		assert_throws([this, &bounded](){ run_regex(bounded, L"x"); }, "Lower bound not enforced");
+
+		// matching requires more states than the cache holds
+		dvl::lazy_dfa dfa(id, L"abcde|abx", 2), unbounded(id, L"abcde|abx");
+		dvl::lazy_dfa::cache small(dfa), large(unbounded);
+		auto match = [&](dvl::lazy_dfa::cache &c, const std::wstring &in){
+			return (&c == &small ? dfa : unbounded).longest_match(c, in.data(), in.data() + in.size());
+		};
+
+		for(const wchar_t *in : {L"abcdef", L"abxab", L"abcd", L"abcde"})
+			assert_equal(match(small, in), match(large, in), "Flushing the cache changed the result");
+
+		assert_equal(match(small, L"abcdef"), 5l, "Invalid match-length");
+		assert_equal(match(small, L"abcd"), -1l, "Partial match accepted");
+		assert_equal(large.get_flush_count(), (std::size_t) 0, "Default cache was flushed");
+
+		std::size_t flushes = small.get_flush_count();
+		assert_true(flushes > 0, "Cache wasn't flushed");
+		assert_equal(match(small, L"abx"), 3l, "Invalid match-length");
+		assert_true(small.get_flush_count() > flushes, "Cache wasn't flushed while matching");
+	}
+};
+
+class test_regex_routine_parallel : public test_regex_routine
+{
+public:
+	test_regex_routine_parallel():
+		test_regex_routine("regex routine parallel", "Tests if parallel parsers match regexes"
+				" of a shared grammar via the dfa")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid loop = {5l, 0l, dvl::TYPE_LOOP},
+				word = {5l, 1l, dvl::TYPE_REGEX};
+
+		dvl::pid_table pt;
+
+		// the dfa needs more states than a cache holds, thus caches are flushed continuously
+		dvl::routine_tree_builder rb;
+		rb.loop(loop, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.match_regex(word, L"[ab]*a[ab]{8} ?");
+
+		std::wstring in;
+		std::vector<long> lengths;
+		unsigned int seed = 1;
+
+		for(int i = 0; i < 200; i++)
+		{
+			std::wstring w;
+			for(int j = 0; j < 10 + i % 7; j++)
+			{
+				seed = seed * 1103515245 + 12345;
+				w += (seed >> 16) & 1 ? L'a' : L'b';
+			}
+
+			w[w.size() - 9] = L'a';
+			w += L' ';
+
+			in += w;
+			lengths.push_back(w.size());
+		}
+
+		std::atomic<int> mismatches{0};
+
+		auto parse = [&](){
+			for(int i = 0; i < 20; i++)
+			{
+				std::wistringstream str(in);
+				dvl::parser_context c(str, rb, pt, factory);
+				dvl::flat_tree_builder fb;
+				c.listeners.push_back(&fb);
+
+				dvl::parser p(c);
+				p.run();
+				delete p.get_result();
+
+				const dvl::flat_tree &t = fb.get();
+				std::vector<long> found;
+				for(dvl::flat_tree::index j = 0; j < t.size(); j++)
+					if(t.get_pid(j) == word)
+						found.push_back(t.get_end(j) - t.get_start(j));
+
+				if(found != lengths)
+					mismatches++;
+			}
+		};
+
+		std::thread t1(parse), t2(parse);
+		t1.join();
+		t2.join();
+
+		dvl::regex_routine probe(word, L"[ab]*a[ab]{8} ?");
+		assert_not_equal(probe.get_dfa(), nullptr, "Regex should be matched by the dfa");
+		assert_equal(mismatches.load(), 0, "Invalid matches of parallel parsers");
+	}
+};
+
+class test_regex_routine_fallback : public test_regex_routine
+{
+public:
+	test_regex_routine_fallback():
+		test_regex_routine("regex routine fallback", "Tests if regexes unsupported by the dfa"
+				" fall back to boost")
+	{}
+
+	void run_test()
+	{
+		dvl::regex_routine backref(id, L"(a+)b\\1");
+		assert_equal(backref.get_dfa(), nullptr, "Backreference can't be matched by the dfa");
+		assert_equal(run_regex(backref, L"aabaac"), 5l, "Invalid match-length");
+		assert_throws([this, &backref](){ run_regex(backref, L"aaba"); }, "Mismatch should fail");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// inline routine
 //
 
+class test_inline_routine : public test
+{
+private:
+	struct digit_scanner
+	{
+		bool operator()(dvl::input_cursor &c) const
+		{
+			long start = c.pos();
+
+			while(c.peek() >= L'0' && c.peek() <= L'9')
+				c.advance();
+
+			return c.pos() > start;
+		}
+	};
+public:
+	test_inline_routine():
+		test("inline routine", "Tests if inline routines consume the input matched by their functor")
+	{}
+
+	void run_test()
+	{
+		dvl::inline_routine<digit_scanner> r({0l, 0l, dvl::TYPE_INLINE}, digit_scanner());
+
+		std::wistringstream str(L"123abc");
+		helper_routine_interface h(str);
+
+		std::unique_ptr<proutine> p(factory.build_routine(&r));
+		p->ri_run(h);
+
+		assert_not_equal(p->get_result(), nullptr, "No output produced");
+		assert_equal(p->get_result()->get_end(), 3l, "Invalid end of output");
+		assert_equal((long) str.tellg(), 3l, "Cursor wasn't committed");
+		delete p->get_result();
+
+		std::unique_ptr<proutine> q(factory.build_routine(&r));
+		assert_throws([this, &q, &h](){ q->ri_run(h); }, "Mismatch should fail");
+		assert_equal((long) str.tellg(), 3l, "Failed run moved the input-stream");
+	}
+};
+
 ///////////////////////////////////////////////////////////////////////////////////
-// test-driver
+// delimited routine
 //
 
-void test_all()
+class test_delimited_routine : public test
 {
-	dvl::routine *echo = new dvl::echo_routine(L"Hi");
-	dvl::routine *fork = new dvl::fork_routine({0l, 0l, dvl::TYPE_FORK}, {echo, echo});
-	dvl::routine *loop = new dvl::loop_routine({0l, 0l, dvl::TYPE_LOOP}, echo);
-	dvl::routine *structr = new dvl::struct_routine({0l, 0l, dvl::TYPE_STRUCT}, echo, echo);
+private:
+	dvl::delimited_routine r{{0l, 0l, dvl::TYPE_DELIMITED}, L')', L'\\', L"\n"};
 
-	std::vector<test*> tests = {
-			// fork_routine
-			new test_routine_result_stable(fork, "fork_routine"),
-			new test_routine_child_placement_premature(fork, "fork_routine"),
-			new test_routine_child_placement_intime(fork, "fork_routine"),
-			new test_fork_routine_multiple_matches,
-			new test_fork_routine_no_match,
-			new test_fork_routine_no_forks,
-			new test_fork_routine_normal,
+	/**
+	 * Runs r on input and returns the stream-position after the run
+	 */
+	long run_delimited(std::wstring input)
+	{
+		std::wistringstream str(input);
+		helper_routine_interface h(str);
 
-			// empty routine
-			new test_empty_routine_single_run,
-			new test_empty_routine_multiple_run,
-			new test_empty_routine_child_placement,
+		std::unique_ptr<proutine> p(factory.build_routine(&r));
+		p->ri_run(h);
 
-			// loop routine
-			new test_routine_result_stable(loop, "loop_routine"),
-			new test_routine_child_placement_premature(loop, "loop_routine"),
-			new test_routine_child_placement_intime(loop, "loop_routine"),
-			new test_loop_routine_failure_min_iter,
-			new test_loop_routine_success_min_iter,
-			new test_loop_routine_success_intermediate_iter,
-			new test_loop_routine_success_last_iter,
+		delete p->get_result();
 
-			// logic routine
-			new test_routine_child_placement_premature(structr, "struct_routine"),
-			new test_routine_child_placement_intime(structr, "struct_routine"),
-			new test_struct_routine_normal_run
+		return str.tellg();
+	}
+public:
+	test_delimited_routine():
+		test("delimited routine", "Tests if delimited routines stop at the first unescaped terminator")
+	{}
+
+	void run_test()
+	{
+		assert_equal(run_delimited(L"abc)"), 3l, "Terminator wasn't found");
+		assert_equal(run_delimited(L"a\\)b)"), 4l, "Escaped terminator wasn't skipped");
+		assert_equal(run_delimited(L"a\\\\)b)"), 3l, "Escaped escape-character wasn't skipped");
+
+		// exceeds the width of a single vector
+		std::wstring lng(37, L'x');
+		assert_equal(run_delimited(lng + L")"), 37l, "Terminator in long input wasn't found");
+
+		assert_throws([this, &lng](){ run_delimited(lng); }, "Unterminated content should fail");
+		assert_throws([this](){ run_delimited(L"ab\ncd)"); }, "Failure-character should fail");
+		assert_throws([this](){ run_delimited(L"ab\\\n)"); }, "Escaped failure-character should fail");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// grammar index
+//
+
+class test_grammar_index : public test
+{
+public:
+	test_grammar_index():
+		test("grammar index", "Tests if grammar_index numbers routines densely and resolves pids")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid l = {5l, 0l, dvl::TYPE_LOOP},
+				f = {5l, 1l, dvl::TYPE_FORK},
+				a = {5l, 2l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::routine_tree_builder b;
+		b.loop(l, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.fork(f).push_checkpoint().set_insertion_mode(im::AS_FORK)
+					.match_string(a, L"a").pop_checkpoint().set_insertion_mode(im::AS_FORK)
+					.match_string(a, L"b");
+
+		dvl::pid_table pt;
+		pt.set_element(a, L"A");
+
+		dvl::grammar_index gi(b, pt);
+
+		assert_equal(gi.routine_count(), (std::size_t) 4, "Invalid number of routines");
+		assert_equal(gi.pid_count(), (std::size_t) 3, "Invalid number of pids");
+		assert_equal(b.get()->get_index(), (std::size_t) 0, "Root should be numbered first");
+
+		for(std::size_t i = 0; i < gi.routine_count(); i++)
+		{
+			assert_equal(gi.get_routine(i)->get_index(), i, "Index wasn't stored in routine");
+			assert_equal(gi.get_pid(gi.pid_of(i)), gi.get_routine(i)->get_pid(), "Invalid pid of routine");
+		}
+
+		assert_not_equal(gi.index_of(a), dvl::grammar_index::NO_INDEX, "Pid wasn't found");
+		assert_equal(gi.index_of({5l, 9l, dvl::TYPE_FORK}), dvl::grammar_index::NO_INDEX, "Unknown pid was found");
+		assert_true(gi.name_of(gi.index_of(a)) == pt.to_string(a, true), "Invalid name");
+
+		std::unique_ptr<proutine> p(factory.build_routine(b.get()));
+		assert_equal(p->get_index(), (std::size_t) 0, "Index wasn't passed to parser_routine");
+	}
+};
+
+class test_factory_binding : public test
+{
+public:
+	test_factory_binding():
+		test("factory binding", "Tests if bound routines are built via their precomputed constructor"
+				" and bindings are dropped on reconfiguration")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		// the builder takes ownership of the echo_routine
+		dvl::routine_tree_builder b;
+		b.loop({5l, 0l, dvl::TYPE_LOOP}, 0, 1).mark_root().set_insertion_mode(im::AS_LOOP)
+				.by_ptr(new dvl::echo_routine(L"Hi"));
+
+		dvl::pid_table pt;
+		dvl::grammar_index gi(b, pt);
+
+		dvl::parser_routine_factory f;
+		dvl::parser_routine_factory::default_config(f);
+		f.bind(gi);
+
+		std::unique_ptr<proutine> echo(f.build_routine(gi.get_routine(1)));
+		assert_equal(echo->get_pid(), dvl::ECHO, "Internal routine wasn't resolved");
+		assert_equal(echo->get_index(), (std::size_t) 1, "Index wasn't passed on");
+
+		int ct = 0;
+		dvl::empty_routine empty;
+		f.register_transformation(dvl::TYPE_LOOP, [&ct, &empty](dvl::routine*)->proutine*{
+			ct++;
+			return factory.build_routine(&empty);
+		});
+
+		std::unique_ptr<proutine> loop(f.build_routine(b.get()));
+		assert_equal(ct, 1, "Stale binding was used");
+	}
+};
+
+class test_grammar_freeze : public test
+{
+public:
+	test_grammar_freeze():
+		test("grammar freeze", "Tests if freeze lays out routines breadth-first and rejects"
+				" undefined declarations")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid l = {5l, 0l, dvl::TYPE_LOOP},
+				s = {5l, 1l, dvl::TYPE_STRUCT},
+				a = {5l, 2l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		dvl::routine_tree_builder b;
+		b.loop(l, 0, 1).mark_root().set_insertion_mode(im::AS_LOOP)
+				.logic(s).name(L"s").set_insertion_mode(im::AS_CHILD)
+				.match_string(a, L"a");
+
+		dvl::grammar g = b.freeze(pt);
+
+		assert_equal(g.size(), (std::size_t) 3, "Invalid number of nodes");
+		assert_equal(g.get(g.root()).id, l, "Root isn't the first node");
+		assert_equal(*g.edges(0).begin(), (dvl::grammar::index) 1, "Invalid edge of loop");
+		assert_equal(g.edges(1).size(), (std::size_t) 2, "Struct should have child and next");
+		assert_equal(*(g.edges(1).begin() + 1), dvl::grammar::NONE, "Missing next should be NONE");
+		assert_equal(g.find(L"s"), (dvl::grammar::index) 1, "Named routine wasn't found");
+		assert_equal(g.get(2).r->get_index(), (std::size_t) 2, "Routine wasn't renumbered");
+		assert_throws([&b](){ b[L"s"].set_output_policy(dvl::output_policy::SILENT); },
+				"Frozen routines must not be modifiable");
+
+		dvl::routine_tree_builder d;
+		d.logic(s).mark_root().name(L"declared");
+		assert_throws([&d, &pt](){ d.freeze(pt); }, "Undefined declaration wasn't detected");
+	}
+};
+
+class test_pass_manager : public test
+{
+public:
+	test_pass_manager():
+		test("pass manager", "Tests if the default passes remove unobservable nodes without"
+				" changing the output of kept pids")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid l = {5l, 0l, dvl::TYPE_LOOP},
+				anon = {5l, 1l, dvl::TYPE_STRUCT},
+				f = {5l, 2l, dvl::TYPE_FORK},
+				k = {5l, 3l, dvl::TYPE_STRUCT},
+				a = {5l, 4l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+		dvl::routine_tree_builder b;
+
+		// loop -> wrapper -> fork of one -> chain (k -> a), wrapper -> a
+		b.loop(l, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.logic(anon).set_insertion_mode(im::AS_CHILD)
+				.fork(f).set_insertion_mode(im::AS_FORK)
+				.logic(anon).push_checkpoint().set_insertion_mode(im::AS_CHILD)
+					.logic(k).set_insertion_mode(im::AS_CHILD).match_string(a, L"a")
+				.pop_checkpoint().set_insertion_mode(im::AS_NEXT)
+				.logic(anon).set_insertion_mode(im::AS_CHILD).match_string(a, L"a");
+
+		auto parse = [&](){
+			std::wistringstream str(L"aaaa");
+			dvl::parser_context c(str, b, pt, factory);
+			dvl::flat_tree_builder fb;
+			c.listeners.push_back(&fb);
+
+			dvl::parser p(c);
+			p.run();
+			delete p.get_result();
+
+			// output restricted to kept pids
+			std::vector<std::tuple<uint64_t, long, long>> kept;
+			const dvl::flat_tree &t = fb.get();
+			for(dvl::flat_tree::index i = 0; i < t.size(); i++)
+				if(t.get_pid(i) == k || t.get_pid(i) == a)
+					kept.emplace_back(t.get_pid(i), t.get_start(i), t.get_end(i));
+
+			return kept;
+		};
+
+		auto expected = parse();
+		assert_equal(expected.size(), (std::size_t) 6, "Invalid output of the input grammar");
+
+		dvl::grammar g = b.freeze(pt);
+
+		dvl::pass_manager pm(b);
+		dvl::pass_manager::default_config(pm);
+		pm.keep(k).keep(a);
+
+		dvl::grammar o = pm.run(g, pt);
+
+		const std::vector<dvl::pass_manager::report_entry> &r = pm.get_report();
+		assert_equal(r.size(), (std::size_t) 5, "Invalid number of report-entries");
+		assert_equal(r[0].before, (std::size_t) 8, "Invalid size of the input");
+		assert_equal(r[0].removed(), (std::size_t) 2, "Wrappers weren't inlined");
+		assert_equal(r[1].removed(), (std::size_t) 1, "Chain wasn't flattened");
+		assert_equal(r[2].removed(), (std::size_t) 1, "Fork of one wasn't eliminated");
+		assert_equal(r[3].removed(), (std::size_t) 0, "Kept chain was replaced by a sequence");
+		assert_equal(r[4].removed(), (std::size_t) 1, "Duplicate matchers weren't merged");
+
+		assert_equal(o.size(), (std::size_t) 3, "Invalid size of the optimized grammar");
+		assert_equal(b.get(), o.get(o.root()).r, "Builder doesn't refer to the optimized grammar");
+		assert_true(parse() == expected, "Output of kept pids changed");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// recognition
+//
+
+class test_recognition : public test
+{
+public:
+	test_recognition():
+		test("recognition", "Tests if the parser recognizes the input without producing output"
+				" and reports the farthest failure")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid seq = {5l, 0l, dvl::TYPE_SEQUENCE},
+				ab = {5l, 1l, dvl::TYPE_STRING_MATCHER},
+				f = {5l, 2l, dvl::TYPE_FORK},
+				cd = {5l, 3l, dvl::TYPE_STRING_MATCHER},
+				ce = {5l, 4l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		// "ab" ("cd" | "ce")
+		dvl::routine_tree_builder b;
+		b.sequence(seq).mark_root().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(ab, L"ab")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.fork(f).push_checkpoint().set_insertion_mode(im::AS_FORK)
+						.match_string(cd, L"cd")
+					.pop_checkpoint().set_insertion_mode(im::AS_FORK)
+						.match_string(ce, L"ce");
+
+		std::size_t reported = 0;
+
+		auto recognize = [&](std::wstring in){
+			std::wistringstream str(in);
+			dvl::parser_context c(str, b, pt, factory);
+			dvl::flat_tree_builder fb;
+			c.listeners.push_back(&fb);
+
+			dvl::parser p(c);
+			dvl::recognition_result r = p.recognize();
+
+			assert_true(p.get_result() == nullptr, "Recognition produced output");
+			reported = fb.get().size();
+
+			return r;
+		};
+
+		dvl::recognition_result r = recognize(L"abce");
+		assert_true(r.matched, "Valid input wasn't recognized");
+		assert_equal(r.farthest, 2l, "Invalid farthest failure");
+		assert_equal(r.expected.size(), (std::size_t) 1, "Invalid expected set");
+		assert_equal(reported, (std::size_t) 0, "Recognition reported output");
+
+		r = recognize(L"abcx");
+		assert_true(!r.matched, "Invalid input was recognized");
+		assert_equal(r.farthest, 2l, "Invalid farthest failure");
+		assert_equal(r.expected.size(), (std::size_t) 2, "Invalid expected set");
+		assert_equal(r.expected[0], cd, "Invalid expected pid");
+		assert_equal(r.expected[1], ce, "Invalid expected pid");
+
+		// the farthest failure is tracked by run as well
+		std::wistringstream str(L"abcx");
+		dvl::parser_context c(str, b, pt, factory);
+		dvl::parser p(c);
+		p.run();
+
+		assert_true(p.get_result() == nullptr, "Invalid input was matched");
+		assert_equal(p.get_farthest(), 2l, "Invalid farthest failure of run");
+		assert_true(p.get_expected() == r.expected, "Expected sets of run and recognize differ");
+
+		// recognizers consume the input without allocating output
+		dvl::string_matcher_routine m(ab, L"ab");
+
+		std::wistringstream in(L"ab");
+		helper_routine_interface h(in);
+
+		std::unique_ptr<proutine> pm(factory.build_recognizer(&m));
+		pm->ri_run(h);
+
+		assert_true(pm->get_result() == nullptr, "Recognizer produced output");
+		assert_equal((long) in.tellg(), 2l, "Recognizer didn't consume the input");
+	}
+};
+
+class test_farthest_failure : public test
+{
+public:
+	test_farthest_failure():
+		test("farthest failure", "Tests if the routines failing at the farthest offset are"
+				" tracked by index and reported once")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid seq = {5l, 0l, dvl::TYPE_SEQUENCE},
+				f = {5l, 1l, dvl::TYPE_FORK},
+				a = {5l, 2l, dvl::TYPE_STRING_MATCHER},
+				b = {5l, 3l, dvl::TYPE_STRING_MATCHER};
+
+		// routines sharing a pid are distinct members, but reported once
+		dvl::expected_set es;
+		es.insert(0, a);
+		es.insert(0, a);
+		es.insert(70, a);
+		es.insert(dvl::routine::NO_INDEX, b);
+		es.insert(dvl::routine::NO_INDEX, b);
+
+		assert_true(es.pids() == std::vector<dvl::pid>({a, b}), "Invalid pids of the expected set");
+
+		es.clear();
+		es.insert(70, b);
+		assert_true(es.pids() == std::vector<dvl::pid>({b}), "Expected set wasn't cleared");
+
+		// literal messages are kept without copying, any other message is copied
+		static const char literal[] = "Mismatch";
+		assert_true(dvl::parser_exception(a, literal).what() == literal, "Static message was copied");
+
+		const char *ptr = literal;
+		assert_true(dvl::parser_exception(a, ptr).what() != ptr, "Message wasn't copied");
+
+		char buf[] = "Mismatch";
+		dvl::parser_exception copied(a, buf);
+		buf[0] = 'X';
+		assert_true(std::string(copied.what()) == "Mismatch", "Message of a buffer wasn't copied");
+
+		// ("a" | "ab") ("xy" | "b"), the matchers of the second fork fail at the same offset,
+		// "b" shares its pid with the matchers of the first fork
+		dvl::pid_table pt;
+		dvl::routine_tree_builder rb;
+		rb.sequence(seq).mark_root().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.fork(f).push_checkpoint().set_insertion_mode(im::AS_FORK)
+						.match_string(a, L"a")
+					.pop_checkpoint().set_insertion_mode(im::AS_FORK)
+						.match_string(a, L"ab")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.fork(f).push_checkpoint().set_insertion_mode(im::AS_FORK)
+						.match_string(b, L"xy")
+					.pop_checkpoint().set_insertion_mode(im::AS_FORK)
+						.match_string(a, L"b");
+
+		rb.freeze(pt);
+
+		std::wistringstream str(L"ax");
+		dvl::parser_context c(str, rb, pt, factory);
+		dvl::parser p(c);
+		p.run();
+
+		assert_true(p.get_result() == nullptr, "Invalid input was matched");
+		assert_equal(p.get_farthest(), 1l, "Invalid farthest failure");
+		
+		std::vector<dvl::pid> e = p.get_expected();
+		assert_equal(e.size(), (std::size_t) 2, "Invalid number of expected pids");
+		assert_true(std::find(e.begin(), e.end(), a) != e.end() && std::find(e.begin(), e.end(), b) != e.end(),
+				"Invalid expected pids");
+		assert_true(p.get_failure_message() == L"Parse error at offset 1: expected " +
+				pt.to_string(e[0]) + L", " + pt.to_string(e[1]), "Invalid failure message");
+
+		// !("a" "x") "c", "x" fails within the successful lookahead beyond the failure of "c"
+		dvl::pid pred = {5l, 4l, dvl::TYPE_PREDICATE},
+				inner = {5l, 5l, dvl::TYPE_SEQUENCE},
+				x = {5l, 6l, dvl::TYPE_STRING_MATCHER},
+				cm = {5l, 7l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::routine_tree_builder lb;
+		lb.sequence(seq).mark_root().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.predicate(pred, true).sequence(inner).push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+						.match_string(a, L"a")
+					.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+						.match_string(x, L"x")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(cm, L"c");
+
+		std::wistringstream lstr(L"ab");
+		dvl::parser_context lc(lstr, lb, pt, factory);
+		dvl::parser lp(lc);
+		lp.run();
+
+		assert_true(lp.get_result() == nullptr, "Invalid input was matched");
+		assert_equal(lp.get_farthest(), 0l, "Failure within a lookahead was recorded");
+		assert_true(lp.get_expected() == std::vector<dvl::pid>({cm}), "Invalid expected pids after lookahead");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// error recovery
+//
+
+class test_error_recovery : public test
+{
+public:
+	test_error_recovery():
+		test("error recovery", "Tests if the parser skips failing iterations of the root-loop"
+				" up to the sync-routine and continues")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid loop = {5l, 0l, dvl::TYPE_LOOP},
+				seq = {5l, 1l, dvl::TYPE_SEQUENCE},
+				digits = {5l, 2l, dvl::TYPE_CHARSET},
+				nl = {5l, 3l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		// ([0-9]* "\n")*
+		dvl::routine_tree_builder b;
+		b.loop(loop, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.sequence(seq).push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_set(digits, L"[0-9]*")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(nl, L"\n");
+
+		dvl::string_matcher_routine newline(nl, L"\n");
+
+		std::wistringstream str(L"12\nx3\n45\n");
+		dvl::parser_context c(str, b, pt, factory);
+		dvl::flat_tree_builder fb;
+		c.listeners.push_back(&fb);
+		c.sync = &newline;
+
+		dvl::parser p(c);
+		p.run();
+
+		std::unique_ptr<dvl::lnstruct> ln(p.get_result());
+		assert_not_equal(ln.get(), nullptr, "Parser didn't recover");
+
+		assert_equal(p.get_errors().size(), (std::size_t) 1, "Invalid number of errors");
+		assert_equal(p.get_errors()[0].start, 3l, "Invalid start of the skipped input");
+		assert_equal(p.get_errors()[0].end, 6l, "Invalid end of the skipped input");
+
+		// the error replaces the second iteration
+		dvl::lnstruct *it = ln->get_child();
+		std::vector<dvl::pid> iterations;
+		for(; it != nullptr; it = it->get_next())
+			iterations.push_back(it->get_child()->get_pid());
+
+		assert_true(iterations == std::vector<dvl::pid>({seq, dvl::PARSE_ERROR, seq}), "Invalid iterations");
+
+		std::size_t reported = 0;
+		for(std::size_t i = 0; i < fb.get().size(); i++)
+			if(fb.get().get_pid(i) == dvl::PARSE_ERROR)
+				reported++;
+
+		assert_equal(reported, (std::size_t) 1, "Error wasn't reported to the listeners");
+
+		// recognition reports recovered errors as mismatch
+		std::wistringstream rstr(L"12\nx3\n45\n");
+		dvl::parser_context rc(rstr, b, pt, factory);
+		rc.sync = &newline;
+
+		dvl::parser rp(rc);
+		assert_true(!rp.recognize().matched, "Input with errors was recognized");
+		assert_equal(rp.get_errors().size(), (std::size_t) 1, "Recognition didn't recover");
+
+		// recovery requires a loop as root
+		dvl::routine_tree_builder sb;
+		sb.match_string(nl, L"\n").mark_root();
+
+		dvl::parser_context sc(rstr, sb, pt, factory);
+		sc.sync = &newline;
+		assert_throws([&sc](){ dvl::parser sp(sc); }, "Recovery without root-loop");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// parser limits
+//
+
+class test_parser_limits : public test
+{
+public:
+	test_parser_limits():
+		test("parser limits", "Tests if the step budget, the deadline and the cancellation-token"
+				" abort the parser and revoke its output")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid loop = {5l, 0l, dvl::TYPE_LOOP},
+				a = {5l, 1l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		// "a"*
+		dvl::routine_tree_builder b;
+		b.loop(loop, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.match_string(a, L"a");
+
+		std::atomic<bool> cancel(false);
+
+		// returns true if the parser was aborted
+		auto parse = [&](uint64_t steps, std::chrono::steady_clock::time_point deadline){
+			std::wistringstream str(std::wstring(100, L'a'));
+			dvl::parser_context c(str, b, pt, factory);
+			dvl::flat_tree_builder fb;
+			c.listeners.push_back(&fb);
+			c.max_steps = steps;
+			c.deadline = deadline;
+			c.cancel = &cancel;
+			c.check_interval = 16;
+
+			dvl::parser p(c);
+
+			bool aborted = false;
+			try{
+				p.run();
+				delete p.get_result();
+			}catch(const dvl::parser_exception&)
+			{
+				aborted = true;
+
+				if(steps != 0)
+					assert_equal(p.get_steps(), steps + 1, "Step budget wasn't checked exactly");
+
+				assert_true(p.get_result() == nullptr, "Aborted parser produced output");
+				assert_equal(fb.get().size(), (std::size_t) 0, "Output wasn't revoked");
+			}
+
+			return aborted;
+		};
+
+		auto never = std::chrono::steady_clock::time_point::max();
+
+		assert_true(!parse(0, never), "Parser without limits was aborted");
+		assert_true(parse(50, never), "Step budget wasn't enforced");
+
+		cancel = true;
+		assert_true(parse(0, never), "Cancellation wasn't checked");
+
+		cancel = false;
+		assert_true(parse(0, std::chrono::steady_clock::now()), "Deadline wasn't checked");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// profiler
+//
+
+class test_profiler : public test
+{
+public:
+	test_profiler():
+		test("profiler", "Tests if the profiler counts runs, consumed and rewound input per pid")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid loop = {5l, 0l, dvl::TYPE_LOOP},
+				seq = {5l, 1l, dvl::TYPE_SEQUENCE},
+				a = {5l, 2l, dvl::TYPE_STRING_MATCHER},
+				b = {5l, 3l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		// ("a" "b")*
+		dvl::routine_tree_builder rb;
+		rb.loop(loop, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.sequence(seq).push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(a, L"a")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(b, L"b");
+
+		dvl::grammar g = rb.freeze(pt);
+
+		dvl::profiler prof(g.size());
+
+		// the last iteration fails after consuming "a"
+		std::wistringstream str(L"ababa");
+		dvl::parser_context c(str, rb, pt, factory);
+		c.prof = &prof;
+
+		dvl::parser p(c);
+		p.run();
+		delete p.get_result();
+
+		std::vector<dvl::profiler::counters> r = prof.report();
+		auto find = [&r](const dvl::pid &id){
+			return *std::find_if(r.begin(), r.end(), [&id](const dvl::profiler::counters &c){ return c.id == id; });
+		};
+
+		uint64_t rewound = 0;
+		for(std::size_t i = 0; i < r.size(); i++)
+		{
+			assert_equal(r[i].invocations, r[i].successes + r[i].failures, "Unbalanced runs");
+			assert_true(r[i].inclusive >= r[i].exclusive, "Exclusive time exceeds inclusive time");
+			assert_true(i == 0 || r[i - 1].exclusive >= r[i].exclusive, "Report isn't sorted");
+
+			rewound += r[i].rewound;
+		}
+
+		assert_equal(find(loop).invocations, (uint64_t) 1, "Invalid invocations of the loop");
+		assert_equal(find(loop).consumed, (uint64_t) 4, "Invalid input consumed by the loop");
+		assert_equal(find(a).successes, (uint64_t) 3, "Invalid successes of the matcher");
+		assert_equal(find(a).consumed, (uint64_t) 3, "Invalid input consumed by the matcher");
+		assert_equal(find(b).successes, (uint64_t) 2, "Invalid successes of the matcher");
+		assert_equal(find(b).failures, (uint64_t) 1, "Invalid failures of the matcher");
+		assert_equal(find(seq).failures, (uint64_t) 1, "Invalid failures of the sequence");
+		assert_equal(find(seq).rewound, (uint64_t) 1, "Invalid input rewound by the sequence");
+		assert_true(find(seq).repeats > 0, "Repeats of the sequence weren't counted");
+		assert_true(rewound > 0, "Rewound input wasn't counted");
+
+		// one line per pid and a header
+		std::wostringstream csv;
+		prof.write(csv, pt, dvl::profiler::format::CSV);
+		std::wstring lines = csv.str();
+		assert_equal((std::size_t) std::count(lines.begin(), lines.end(), L'\n'), r.size() + 1,
+				"Invalid number of lines");
+		assert_equal(lines.find(L"name,invocations,"), (std::size_t) 0, "Invalid CSV-header");
+
+		// names are escaped in JSON
+		pt.set_element(seq, L"s\"eq\n");
+
+		std::wostringstream json;
+		prof.write(json, pt, dvl::profiler::format::JSON);
+		assert_equal(json.str().find(L"[{\"name\":\""), (std::size_t) 0, "Invalid JSON");
+		assert_true(json.str().find(L"s\\\"eq\\u000a") != std::wstring::npos, "Name wasn't escaped");
+		assert_true(json.str().find(L'\n') == json.str().size() - 1, "Unescaped control-character");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// heatmap
+//
+
+class test_heatmap : public test
+{
+public:
+	test_heatmap():
+		test("heatmap", "Tests if the heatmap counts reads per offset and charges the routines"
+				" rewinding the input")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid loop = {5l, 0l, dvl::TYPE_LOOP},
+				seq = {5l, 1l, dvl::TYPE_SEQUENCE},
+				pred = {5l, 2l, dvl::TYPE_PREDICATE},
+				ab = {5l, 3l, dvl::TYPE_STRING_MATCHER},
+				word = {5l, 4l, dvl::TYPE_CHARSET},
+				nl = {5l, 5l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		// (&"ab" [a-z]* "\n")*
+		dvl::routine_tree_builder b;
+		b.loop(loop, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.sequence(seq).push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.predicate(pred).match_string(ab, L"ab")
+				.pop_checkpoint().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_set(word, L"[a-z]*")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(nl, L"\n");
+
+		for(bool build : {true, false})
+		{
+			dvl::heatmap h;
+
+			std::wistringstream str(L"abc\nabd\n");
+			dvl::parser_context c(str, b, pt, factory);
+			c.heat = &h;
+
+			dvl::parser p(c);
+			if(build)
+			{
+				p.run();
+				delete p.get_result();
+			}
+			else
+				assert_true(p.recognize().matched, "Input wasn't recognized");
+
+			// the predicate reads "ab" twice, the charset the newline
+			std::vector<uint32_t> reads;
+			for(long o = 0; o < 8; o++)
+				reads.push_back(h.count(o));
+
+			assert_true(reads == std::vector<uint32_t>({2, 2, 1, 2, 2, 2, 1, 2}), "Invalid reads");
+
+			std::vector<dvl::heatmap::line> lines = h.lines();
+			assert_equal(lines.size(), (std::size_t) 2, "Invalid number of lines");
+			assert_equal(lines[1].start, 4l, "Invalid start of the line");
+			assert_equal(lines[1].rereads, (uint64_t) 3, "Invalid rereads");
+			assert_true(lines[1].responsible == dvl::heatmap::charges({{pred, 2}, {word, 1}}),
+					"Invalid routines responsible");
+
+			std::vector<dvl::heatmap::region> hot = h.hot_regions();
+			assert_equal(hot.size(), (std::size_t) 3, "Invalid number of hot regions");
+			assert_equal(hot[0].start, 3l, "Invalid start of the hottest region");
+			assert_equal(hot[0].end, 6l, "Invalid end of the hottest region");
+			assert_equal(hot[0].first_line, (std::size_t) 1, "Invalid lines of the hottest region");
+			assert_equal(hot[0].last_line, (std::size_t) 2, "Invalid lines of the hottest region");
+			assert_true(h.hot_regions(3).empty(), "Invalid hot regions");
+
+			std::wostringstream out;
+			h.write(out, pt);
+			assert_equal(out.str().find(L"8 characters, 14 reads, 6 rereads\n"), (std::size_t) 0,
+					"Invalid summary");
+		}
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// stack sampler
+//
+
+class test_stack_sampler : public test
+{
+public:
+	test_stack_sampler():
+		test("stack sampler", "Tests if stack traces and samples list the routines on the stack"
+				" and if the sampler is driven by the timer")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+
+		dvl::pid seq = {5l, 0l, dvl::TYPE_SEQUENCE},
+				a = {5l, 1l, dvl::TYPE_STRING_MATCHER},
+				l = {5l, 2l, dvl::TYPE_LAMBDA},
+				b = {5l, 3l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+		dvl::stack_sampler sampler;
+		std::wostringstream trace;
+
+		// "a" <request sample> <stack trace> "b"
+		dvl::routine_tree_builder rb;
+		rb.sequence(seq).mark_root().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(a, L"a")
+				.pop_checkpoint().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.lambda(l, [&sampler](dvl::routine_interface&)->dvl::lnstruct*{
+						sampler.request();
+						return nullptr;
+					})
+				.pop_checkpoint().push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.by_ptr(new dvl::stack_trace_routine(trace))
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(b, L"b");
+
+		{
+			std::wistringstream str(L"ab");
+			dvl::parser_context c(str, rb, pt, factory);
+			c.sampler = &sampler;
+
+			dvl::parser p(c);
+			p.run();
+			delete p.get_result();
+		}
+
+		// the sample is taken once the sequence continues
+		std::wstring folded = pt.to_string(dvl::ROOT) + L";" + pt.to_string(seq) + L" 1\n";
+		std::wostringstream out;
+		sampler.write(out, pt);
+
+		assert_equal(sampler.get_samples(), (uint64_t) 1, "Invalid number of samples");
+		assert_true(out.str() == folded, "Invalid folded stacks");
+
+		std::wstring lines = trace.str();
+		assert_equal(lines.find(L"stack trace at offset 1:\n"), (std::size_t) 0, "Invalid stack trace");
+		assert_equal((std::size_t) std::count(lines.begin(), lines.end(), L'\n'), (std::size_t) 4,
+				"Invalid number of frames");
+		assert_true(lines.find(L"\t" + pt.to_string(seq) + L" at offset 0\n") != std::wstring::npos,
+				"Frame missing in stack trace");
+
+		// timer-driven sampling
+		dvl::pid loop = {6l, 0l, dvl::TYPE_LOOP},
+				word = {6l, 1l, dvl::TYPE_CHARSET};
+
+		dvl::routine_tree_builder wb;
+		wb.loop(loop, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.match_set(word, L"[a-z]");
+
+		dvl::stack_sampler timed, other;
+
+		assert_true(timed.start(std::chrono::microseconds(1000)), "Sampler didn't start");
+		assert_true(!other.start(std::chrono::microseconds(1000)), "Multiple samplers started");
+
+		std::wstring in(10000, L'x');
+		for(int i = 0; i < 1000 && timed.get_samples() == 0; i++)
+		{
+			std::wistringstream str(in);
+			dvl::parser_context c(str, wb, pt, factory);
+			c.sampler = &timed;
+
+			dvl::parser p(c);
+			p.run();
+			delete p.get_result();
+		}
+
+		timed.stop();
+
+		assert_true(timed.get_samples() > 0, "No samples were taken");
+		assert_true(other.start(std::chrono::microseconds(1000)), "Sampler wasn't stopped");
+		other.stop();
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// trace recorder
+//
+
+class test_trace_recorder : public test
+{
+public:
+	test_trace_recorder():
+		test("trace recorder", "Tests if parallel parsers record nested routine-events and"
+				" backtracking into a shared recorder")
+	{}
+
+	void run_test()
+	{
+		typedef dvl::routine_tree_builder::insertion_mode im;
+		typedef dvl::trace_recorder::kind kind;
+
+		dvl::pid loop = {5l, 0l, dvl::TYPE_LOOP},
+				seq = {5l, 1l, dvl::TYPE_SEQUENCE},
+				a = {5l, 2l, dvl::TYPE_STRING_MATCHER},
+				b = {5l, 3l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::pid_table pt;
+
+		// ("a" "b")*
+		dvl::routine_tree_builder rb;
+		rb.loop(loop, 0, dvl::loop_routine::_INFINITY).mark_root().set_insertion_mode(im::AS_LOOP)
+				.sequence(seq).push_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(a, L"a")
+				.pop_checkpoint().set_insertion_mode(im::AS_ELEMENT)
+					.match_string(b, L"b");
+
+		// the last iteration fails after consuming "a"
+		auto parse = [&](dvl::trace_recorder &rec){
+			std::wistringstream str(L"ababa");
+			dvl::parser_context c(str, rb, pt, factory);
+			c.trace = &rec;
+
+			dvl::parser p(c);
+			p.run();
+			delete p.get_result();
+		};
+
+		// small chunks force the writers to interleave
+		dvl::trace_recorder rec(1 << 12, 4);
+
+		std::thread t1(parse, std::ref(rec)), t2(parse, std::ref(rec));
+		t1.join();
+		t2.join();
+
+		std::vector<dvl::trace_recorder::event> events = rec.get_events();
+		assert_equal(rec.get_dropped(), (uint64_t) 0, "Events were dropped");
+
+		for(uint32_t tid = 0; tid < 2; tid++)
+		{
+			long depth = 0;
+			std::size_t backtracks = 0;
+
+			for(const dvl::trace_recorder::event &e : events)
+			{
+				if(e.tid != tid)
+					continue;
+
+				if(e.k == kind::BEGIN)
+					depth++;
+				else if(e.k == kind::END || e.k == kind::FAIL)
+					assert_true(--depth >= 0, "Unbalanced events");
+				else if(e.k == kind::BACKTRACK)
+				{
+					assert_equal(dvl::pid(e.id), seq, "Invalid routine backtracking");
+					assert_equal(e.offset, 4l, "Invalid target of the backtrack");
+					assert_equal(e.end, 5l, "Invalid origin of the backtrack");
+					backtracks++;
+				}
+			}
+
+			assert_equal(depth, 0l, "Unbalanced events");
+			assert_equal(backtracks, (std::size_t) 1, "Invalid number of backtracks");
+		}
+
+		std::wostringstream out;
+		rec.write(out, pt);
+		assert_equal(out.str().find(L"{\"traceEvents\":["), (std::size_t) 0, "Invalid JSON");
+		assert_true(out.str().find(L"\"name\":\"" + pt.to_string(seq) + L"\"") != std::wstring::npos,
+				"Names of pids missing");
+
+		// names are escaped
+		pt.set_element(seq, L"s\"eq\t");
+
+		std::wostringstream escaped;
+		rec.write(escaped, pt);
+		assert_true(escaped.str().find(L"s\\\"eq\\u0009") != std::wstring::npos, "Name wasn't escaped");
+		assert_true(escaped.str().find(L'\t') == std::wstring::npos, "Unescaped control-character");
+
+		// events exceeding the capacity are dropped
+		dvl::trace_recorder small(4, 2);
+		parse(small);
+
+		assert_equal(small.get_events().size(), (std::size_t) 4, "Invalid number of events");
+		assert_true(small.get_dropped() > 0, "Dropped events weren't counted");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// flat tree
+//
+
+class test_flat_tree : public test
+{
+public:
+	test_flat_tree():
+		test("flat tree", "Tests if flat_tree_builder links nodes in preorder, truncates"
+				" on rewind and converts from and to lnstruct")
+	{}
+
+	void run_test()
+	{
+		dvl::pid a = {0l, 0l, dvl::TYPE_STRUCT},
+				b = {0l, 1l, dvl::TYPE_STRUCT};
+
+		dvl::flat_tree_builder fb;
+		fb.enter(a, 0);		// 0
+		fb.enter(b, 0);		// 1
+		fb.exit(2);
+		fb.enter(b, 2);		// 2 - revoked
+		fb.enter(b, 2);		// 3 - revoked
+		fb.rewind(2);
+		fb.enter(a, 2);		// 2
+		fb.exit(4);
+		fb.exit(4);
+		fb.enter(b, 4);		// 3 - second root
+		fb.exit(5);
+
+		const dvl::flat_tree &t = fb.get();
+		assert_equal(t.size(), (std::size_t) 4, "Invalid node-count");
+		assert_equal(t.get_child(0), (dvl::flat_tree::index) 1, "Invalid first child");
+		assert_equal(t.get_next(1), (dvl::flat_tree::index) 2, "Sibling wasn't relinked after rewind");
+		assert_equal(t.get_next(2), dvl::flat_tree::NONE, "Invalid last sibling");
+		assert_equal(t.get_next(0), (dvl::flat_tree::index) 3, "Roots aren't linked");
+		assert_equal(t.get_end(0), 4l, "Invalid end");
+
+		std::unique_ptr<dvl::lnstruct> ln(t.to_lnstruct());
+		assert_equal(ln->total_count(), 4, "Invalid node-count after conversion");
+
+		dvl::flat_tree c = dvl::flat_tree::from_lnstruct(ln.get());
+		assert_equal(c.size(), t.size(), "Invalid node-count after back-conversion");
+
+		for(dvl::flat_tree::index i = 0; i < c.size(); i++)
+		{
+			assert_equal(c.get_pid(i), t.get_pid(i), "Pid mismatch after conversion");
+			assert_equal(c.get_child(i), t.get_child(i), "Child mismatch after conversion");
+			assert_equal(c.get_next(i), t.get_next(i), "Sibling mismatch after conversion");
+		}
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// event stream
+//
+
+class test_event_stream : public test
+{
+private:
+	/**
+	 * Records events as string: E(nter), X(exit), T(oken)
+	 */
+	struct recorder : public dvl::event_sink
+	{
+		std::string events;
+
+		void enter(const dvl::pid &, long){ events += "E"; }
+		void exit(const dvl::pid &, long, long){ events += "X"; }
+		void token(const dvl::pid &, long, long){ events += "T"; }
+	};
+public:
+	test_event_stream():
+		test("event stream", "Tests if event_stream holds back uncommitted events and drops"
+				" revoked ones")
+	{}
+
+	void run_test()
+	{
+		dvl::pid id = {0l, 0l, dvl::TYPE_STRUCT};
+
+		recorder r;
+		dvl::event_stream es(r);
+
+		es.enter(id, 0);	// 0
+		es.enter(id, 0);	// 1
+		es.exit(1);
+		es.enter(id, 1);	// 2 - revoked
+		es.exit(2);
+		assert_equal(r.events, std::string(""), "Uncommitted events were passed to the sink");
+
+		es.rewind(2);
+		es.commit(2);
+		assert_equal(r.events, std::string("ET"), "Committed events weren't passed to the sink");
+
+		es.exit(1);
+		es.commit(2);
+		assert_equal(r.events, std::string("ETX"), "Revoked events were passed to the sink");
+		assert_equal(es.buffered(), (std::size_t) 0, "Events remain in the buffer");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// binary tree
+//
+
+class test_binary_tree : public test
+{
+public:
+	test_binary_tree():
+		test("binary tree", "Tests if a tree written by binary_tree_writer is read back"
+				" unchanged, including the names of pids")
+	{}
+
+	void run_test()
+	{
+		dvl::pid a = {5l, 0l, dvl::TYPE_STRUCT},
+				b = {5l, 1l, dvl::TYPE_STRING_MATCHER};
+
+		dvl::flat_tree_builder fb;
+		fb.enter(a, 0);
+		fb.enter(b, 0);
+		fb.exit(2);
+		fb.enter(b, 300);
+		fb.exit(302);
+		fb.exit(400);
+		fb.enter(b, 400);
+		fb.exit(401);
+		const dvl::flat_tree &t = fb.get();
+
+		dvl::pid_table names;
+		names.set_group(a, L"G");
+		names.set_element(b, L"B");
+
+		std::ostringstream out;
+		dvl::binary_tree_writer w(out, &names);
+		w.write(t);
+		w.finish();
+
+		std::string data = out.str();
+		dvl::binary_tree_reader r(data.data(), data.size());
+
+		assert_equal(r.size(), (uint64_t) 4, "Invalid node-count");
+		assert_equal(r.get_pids().size(), (std::size_t) 2, "Invalid dictionary");
+
+		dvl::flat_tree c = r.to_flat_tree();
+		assert_equal(c.size(), t.size(), "Invalid node-count after reading");
+
+		for(dvl::flat_tree::index i = 0; i < c.size(); i++)
+		{
+			assert_equal(c.get_pid(i), t.get_pid(i), "Pid mismatch");
+			assert_equal(c.get_start(i), t.get_start(i), "Start mismatch");
+			assert_equal(c.get_end(i), t.get_end(i), "End mismatch");
+			assert_equal(c.get_child(i), t.get_child(i), "Child mismatch");
+			assert_equal(c.get_next(i), t.get_next(i), "Sibling mismatch");
+		}
+
+		dvl::pid_table loaded;
+		r.load_names(loaded);
+		assert_true(loaded.get_element(b) == L"B", "Names weren't stored");
+
+		data[data.size() - 1] = 'X';
+		assert_throws([&data](){ dvl::binary_tree_reader(data.data(), data.size()); },
+				"Invalid magic wasn't detected");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// structure writer
+//
+
+class test_structure_writer : public test
+{
+public:
+	test_structure_writer():
+		test("structure writer", "Tests the output of structure_writer in all formats")
+	{}
+
+	void run_test()
+	{
+		dvl::pid a = {5l, 0l, dvl::TYPE_STRUCT};
+
+		dvl::pid_table pt;
+		pt.set_group(a, L"G");
+		pt.set_element(a, L"\"A\"");
+
+		std::unique_ptr<dvl::lnstruct> ln(new dvl::lnstruct(a, 0));
+		ln->set_end(3);
+		ln->get_child() = new dvl::lnstruct(a, 1);
+		ln->get_child()->set_end(2);
+		ln->get_next() = new dvl::lnstruct(a, 3);
+		ln->get_next()->set_end(4);
+
+		std::wstring name = L"Group=G/Element=\"A\"/Type=TYPE_STRUCT";
+		assert_true(ln->structure(pt, L">") ==
+				L">" + name + L" start=0 end=3\n>\t" + name + L" start=1 end=2\n>" + name + L" start=3 end=4\n",
+				"Invalid text-output");
+
+		// small buffer to force intermediate flushes
+		std::wostringstream json;
+		dvl::structure_writer(json, pt, dvl::structure_writer::format::JSON, 7).write(ln.get());
+
+		std::wstring jname = L"Group=G/Element=\\\"A\\\"/Type=TYPE_STRUCT";
+		assert_true(json.str() == L"[{\"pid\":\"" + jname + L"\",\"start\":0,\"end\":3,\"children\":[{\"pid\":\"" +
+				jname + L"\",\"start\":1,\"end\":2}]},{\"pid\":\"" + jname + L"\",\"start\":3,\"end\":4}]\n",
+				"Invalid json-output");
+
+		std::wostringstream xml;
+		dvl::structure_writer(xml, pt, dvl::structure_writer::format::XML).write(
+				dvl::flat_tree::from_lnstruct(ln.get()));
+		assert_true(xml.str().find(L"<node pid=\"Group=G/Element=&quot;A&quot;/Type=TYPE_STRUCT\" start=\"1\" end=\"2\"/>")
+				!= std::wstring::npos, "Invalid xml-output");
+		assert_true(xml.str().find(L"\t</node>\n\t<node") != std::wstring::npos, "Unbalanced xml-output");
+	}
+};
+
+class test_structure_writer_schema : public test
+{
+public:
+	test_structure_writer_schema():
+		test("structure writer schema", "Tests if the xml-output of structure_writer uses the namespaces,"
+				" elements and attributes of xml/parser_struct.xsd")
+	{}
+
+	void run_test()
+	{
+		std::wstring xsd;
+		for(const char *path : {"../xml/parser_struct.xsd", "xml/parser_struct.xsd"})
+		{
+			std::wifstream in(path);
+			if(in)
+			{
+				xsd.assign(std::istreambuf_iterator<wchar_t>(in), std::istreambuf_iterator<wchar_t>());
+				break;
+			}
+		}
+
+		assert_true(!xsd.empty(), "Schema not found");
+
+		std::wsmatch m;
+		assert_true(std::regex_search(xsd, m, std::wregex(L"targetNamespace=\"([^\"]*)\"")), "No target namespace");
+		std::wstring tns = m[1];
+
+		// local elements are only qualified, if requested by the schema
+		bool qualified = xsd.find(L"elementFormDefault=\"qualified\"") != std::wstring::npos;
+
+		std::set<std::wstring> elements, attributes;
+		std::wregex decl(L"<(element|attribute) name=\"([^\"]*)\"");
+		for(std::wsregex_iterator it(xsd.begin(), xsd.end(), decl), end; it != end; it++)
+			((*it)[1] == L"element" ? elements : attributes).insert((*it)[2]);
+
+		dvl::pid a = {5l, 0l, dvl::TYPE_STRUCT};
+		dvl::pid_table pt;
+
+		std::unique_ptr<dvl::lnstruct> ln(new dvl::lnstruct(a, 0));
+		ln->set_end(3);
+		ln->get_child() = new dvl::lnstruct(a, 1);
+		ln->get_child()->set_end(2);
+		ln->get_next() = new dvl::lnstruct(a, 3);
+		ln->get_next()->set_end(4);
+
+		std::wostringstream out;
+		dvl::structure_writer(out, pt, dvl::structure_writer::format::XML).write(ln.get());
+		std::wstring xml = out.str();
+
+		// namespaces declared on the root, "" is the default namespace
+		std::map<std::wstring, std::wstring> ns = {{L"", L""}};
+
+		std::wregex tag(L"<([A-Za-z_]+:)?([A-Za-z_]+)([^>]*)>"), attr(L"([A-Za-z_:]+)=\"([^\"]*)\"");
+		std::size_t nodes = 0;
+		bool root = true;
+
+		for(std::wsregex_iterator it(xml.begin(), xml.end(), tag), end; it != end; it++)
+		{
+			std::wstring prefix = (*it)[1], name = (*it)[2], attrs = (*it)[3];
+			if(!prefix.empty())
+				prefix.pop_back();
+
+			for(std::wsregex_iterator at(attrs.begin(), attrs.end(), attr); at != end; at++)
+			{
+				std::wstring an = (*at)[1];
+
+				if(an == L"xmlns" || an.compare(0, 6, L"xmlns:") == 0)
+				{
+					assert_true(root, "Namespace declared below the root");
+					ns[an == L"xmlns" ? L"" : an.substr(6)] = (*at)[2];
+				}
+				else
+					assert_true(attributes.count(an) > 0, "Attribute not declared in the schema");
+			}
+
+			assert_true(ns.count(prefix) > 0, "Undeclared prefix");
+			assert_true(elements.count(name) > 0, "Element not declared in the schema");
+
+			if(root)
+				assert_true(name == L"tree" && ns[prefix] == tns, "Root isn't in the target namespace");
+			else
+			{
+				assert_true(ns[prefix] == (qualified ? tns : L""), "Node in the wrong namespace");
+				nodes++;
+			}
+
+			root = false;
+		}
+
+		assert_equal(nodes, (std::size_t) 3, "Invalid number of nodes");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// text view
+//
+
+class test_text_view : public test
+{
+public:
+	test_text_view():
+		test("text view", "Tests if the text of nodes is extracted from the input by pid")
+	{}
+
+	void run_test()
+	{
+		dvl::pid a = {5l, 0l, dvl::TYPE_STRUCT},
+				name = {5l, 1l, dvl::TYPE_CHARSET};
+
+		std::wstring in = L"foo bar";
+
+		std::unique_ptr<dvl::lnstruct> ln(new dvl::lnstruct(a, 0));
+		ln->set_end(7);
+		ln->get_child() = new dvl::lnstruct(name, 0);
+		ln->get_child()->set_end(3);
+		ln->get_child()->get_next() = new dvl::lnstruct(name, 4);
+		ln->get_child()->get_next()->set_end(7);
+
+		std::vector<dvl::text_view> v;
+		dvl::extract_text(in, ln.get(), name, v);
+
+		assert_equal(v.size(), (std::size_t) 2, "Invalid number of names");
+		assert_true(v[0] == L"foo" && v[1] == L"bar", "Invalid text");
+		assert_equal(v[0].data(), in.data(), "Text was copied");
+
+		v.clear();
+		dvl::extract_text(in, dvl::flat_tree::from_lnstruct(ln.get()), name, v);
+		assert_true(v.size() == 2 && v[1] == L"bar", "Invalid text from flat_tree");
+
+		assert_true(dvl::text_of(in, 5, 20) == L"ar", "Range wasn't clamped");
+		assert_equal(dvl::lnstruct(a, 3).get_end(), 3l, "Default end should equal start");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// pid index
+//
+
+class test_pid_index : public test
+{
+public:
+	test_pid_index():
+		test("pid index", "Tests if pid_index drops revoked nodes and finds overlapping nodes")
+	{}
+
+	void run_test()
+	{
+		dvl::pid a = {5l, 0l, dvl::TYPE_STRUCT},
+				b = {5l, 1l, dvl::TYPE_CHARSET};
+
+		dvl::pid_index idx;
+		idx.enter(a, 0);		// 0
+		idx.enter(b, 0);		// 1
+		idx.exit(2);
+		idx.enter(b, 2);		// 2 - revoked
+		idx.rewind(2);
+		idx.enter(a, 2);		// 2
+		idx.enter(b, 3);		// 3
+		idx.exit(6);
+		idx.enter(b, 6);		// 4
+		idx.exit(6);
+		idx.exit(10);
+		idx.exit(10);
+
+		assert_equal(idx.size(), (std::size_t) 5, "Invalid node-count");
+		assert_equal(idx.count(b), (std::size_t) 3, "Revoked node wasn't dropped");
+		assert_equal(idx.get(a)[0].end, 10l, "Invalid end");
+
+		std::vector<std::size_t> found;
+		auto collect = [&found](const dvl::pid_index::entry &e){ found.push_back(e.node); };
+
+		idx.overlapping(b, 2, 6, collect);
+		assert_true(found == std::vector<std::size_t>{3}, "Invalid overlap");
+
+		found.clear();
+		idx.overlapping(b, 1, 7, collect);
+		assert_true(found == std::vector<std::size_t>({1, 3, 4}), "Invalid overlap with empty node");
+
+		found.clear();
+		idx.overlapping(a, 4, 5, collect);
+		assert_true(found == std::vector<std::size_t>({0, 2}), "Nested nodes weren't found");
+
+		std::size_t ct = 0;
+		idx.for_each_in_group(5, [&ct](const dvl::pid&, const std::vector<dvl::pid_index::entry> &e){
+			ct += e.size();
+		});
+		assert_equal(ct, (std::size_t) 5, "Invalid group-lookup");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// tree stats
+//
+
+class test_tree_stats : public test
+{
+public:
+	test_tree_stats():
+		test("tree stats", "Tests if stats_listener reverts statistics of revoked nodes and"
+				" detects malformed output")
+	{}
+
+	void run_test()
+	{
+		dvl::pid a = {5l, 0l, dvl::TYPE_STRUCT},
+				b = {5l, 1l, dvl::TYPE_CHARSET};
+
+		dvl::stats_listener sl;
+		sl.enter(a, 0);		// 0
+		sl.enter(b, 0);		// 1
+		sl.exit(2);
+		sl.commit(2);
+		sl.enter(a, 2);		// 2 - revoked
+		sl.enter(b, 2);		// 3 - revoked
+		sl.exit(5);
+		sl.rewind(2);
+		sl.enter(b, 2);		// 2
+		sl.exit(3);
+
+		dvl::tree_stats s = sl.get();
+		assert_equal(s.nodes, (std::size_t) 3, "Invalid node-count");
+		assert_equal(s.max_depth, (std::size_t) 2, "Depth of revoked nodes wasn't reverted");
+		assert_equal(s.per_type[dvl::TYPE_STRUCT], (std::size_t) 1, "Invalid count per type");
+		assert_equal(s.per_type[dvl::TYPE_CHARSET], (std::size_t) 2, "Invalid count per type");
+		assert_equal(s.well_formed, false, "Open node wasn't detected");
+
+		sl.exit(3);
+		assert_equal(sl.get().well_formed, true, "Valid output reported as malformed");
+
+		sl.enter(a, 1);
+		sl.exit(2);
+		assert_equal(sl.get().well_formed, false, "Overlapping siblings weren't detected");
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// parser matcher routine
+//
+
+///////////////////////////////////////////////////////////////////////////////////
+// test-driver
+//
+
+void test_all()
+{
+	dvl::routine *echo = new dvl::echo_routine(L"Hi");
+	dvl::routine *fork = new dvl::fork_routine({0l, 0l, dvl::TYPE_FORK}, {echo, echo});
+	dvl::routine *loop = new dvl::loop_routine({0l, 0l, dvl::TYPE_LOOP}, echo);
+	dvl::routine *structr = new dvl::struct_routine({0l, 0l, dvl::TYPE_STRUCT}, echo, echo);
+	dvl::routine *sequence = new dvl::sequence_routine({0l, 0l, dvl::TYPE_SEQUENCE}, {echo, echo});
+
+	std::vector<test*> tests = {
+			// fork_routine
+			new test_routine_result_stable(fork, "fork_routine"),
+			new test_routine_child_placement_premature(fork, "fork_routine"),
+			new test_routine_child_placement_intime(fork, "fork_routine"),
+			new test_fork_routine_multiple_matches,
+			new test_fork_routine_no_match,
+			new test_fork_routine_no_forks,
+			new test_fork_routine_normal,
+
+			// empty routine
+			new test_empty_routine_single_run,
+			new test_empty_routine_multiple_run,
+			new test_empty_routine_child_placement,
+
+			// loop routine
+			new test_routine_result_stable(loop, "loop_routine"),
+			new test_routine_child_placement_premature(loop, "loop_routine"),
+			new test_routine_child_placement_intime(loop, "loop_routine"),
+			new test_loop_routine_failure_min_iter,
+			new test_loop_routine_success_min_iter,
+			new test_loop_routine_success_intermediate_iter,
+			new test_loop_routine_success_last_iter,
+			new test_loop_routine_transparent_helper,
+
+			// sequence routine
+			new test_routine_result_stable(sequence, "sequence_routine"),
+			new test_routine_child_placement_premature(sequence, "sequence_routine"),
+			new test_routine_child_placement_intime(sequence, "sequence_routine"),
+			new test_sequence_routine_normal_run,
+			new test_sequence_parse,
+
+			// predicate routine
+			new test_predicate_routine,
+			new test_predicate_parse,
+
+			// logic routine
+			new test_routine_child_placement_premature(structr, "struct_routine"),
+			new test_routine_child_placement_intime(structr, "struct_routine"),
+			new test_struct_routine_normal_run,
+
+			// regex routine
+			new test_regex_routine_dfa,
+			new test_regex_routine_parallel,
+			new test_regex_routine_fallback,
+
+			// inline routine
+			new test_inline_routine,
+
+			// delimited routine
+			new test_delimited_routine,
+
+			// grammar
+			new test_grammar_index,
+			new test_factory_binding,
+			new test_grammar_freeze,
+			new test_pass_manager,
+
+			// recognition
+			new test_recognition,
+			new test_farthest_failure,
+
+			// error recovery
+			new test_error_recovery,
+
+			// parser limits
+			new test_parser_limits,
+
+			// profiler
+			new test_profiler,
+
+			// heatmap
+			new test_heatmap,
+
+			// stack sampler
+			new test_stack_sampler,
+
+			// trace recorder
+			new test_trace_recorder,
+
+			// output
+			new test_flat_tree,
+			new test_event_stream,
+			new test_binary_tree,
+			new test_structure_writer,
+			new test_structure_writer_schema,
+			new test_text_view,
+			new test_pid_index,
+			new test_tree_stats
 	};
 
 	// run tests
@@ -890,6 +2910,7 @@ void test_all()
 	delete echo;
 	delete fork;
 	delete loop;
+	delete sequence;
 	std::for_each(tests.begin(), tests.end(), [](test *t)->void{ delete t; });
 }
 
@@ -0,0 +1,58 @@
+#ifndef UTIL_ESCAPE_HPP_
+#define UTIL_ESCAPE_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// escaping
+	//
+
+	/**
+	 * Escapes str for the content of a JSON-string. Quotes and backslashes are prefixed with
+	 * a backslash, control-characters are written as \\u00XX.
+	 *
+	 * @param str the string to escape
+	 * @param put functor providing <code>operator()(wchar_t)</code>, receives the escaped string
+	 */
+	template<typename P>
+	void escape_json(const std::wstring &str, P put)
+	{
+		const wchar_t *hex = L"0123456789abcdef";
+
+		for(wchar_t c : str)
+		{
+			if(c == L'"' || c == L'\\')
+			{
+				put(L'\\');
+				put(c);
+			}
+			else if(static_cast<uint32_t>(c) < 0x20)
+			{
+				put(L'\\');
+				put(L'u');
+				put(L'0');
+				put(L'0');
+				put(hex[c >> 4]);
+				put(hex[c & 0xF]);
+			}
+			else
+				put(c);
+		}
+	}
+
+	/**
+	 * Writes str as quoted JSON-string
+	 */
+	inline void put_json_string(std::wostream &out, const std::wstring &str)
+	{
+		out << L'"';
+		escape_json(str, [&out](wchar_t c){ out << c; });
+		out << L'"';
+	}
+}
+
+#endif /* UTIL_ESCAPE_HPP_ */
@@ -0,0 +1,181 @@
+#include "heatmap.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+dvl::heatmap::charges
+dvl::heatmap::sorted(const std::unordered_map<uint64_t, uint64_t> &c)
+	const
+{
+	charges r(c.begin(), c.end());
+
+	std::sort(r.begin(), r.end(), [](const std::pair<pid, uint64_t> &a, const std::pair<pid, uint64_t> &b){
+		return a.second != b.second ? a.second > b.second : (uint64_t) a.first < (uint64_t) b.first;
+	});
+
+	return r;
+}
+
+void
+dvl::heatmap::index(const std::wstring &input)
+{
+	reads.assign(input.size(), 0);
+
+	line_starts.assign(1, 0);
+	for(std::size_t i = 0; i + 1 < input.size(); i++)
+		if(input[i] == L'\n')
+			line_starts.push_back(i + 1);
+
+	rewound.assign(line_starts.size(), {});
+}
+
+void
+dvl::heatmap::consume(long first, long last)
+{
+	first = std::max(first, 0l);
+	last = std::min(last, (long) reads.size());
+
+	for(long o = first; o < last; o++)
+		reads[o]++;
+}
+
+void
+dvl::heatmap::rewind(long first, long last, const pid &id)
+{
+	first = std::max(first, 0l);
+	last = std::min(last, (long) reads.size());
+
+	for(std::size_t l = line_of(first); first < last; l++)
+	{
+		long end = l + 1 < line_starts.size() ? std::min(last, line_starts[l + 1]) : last;
+
+		rewound[l][id] += end - first;
+		first = end;
+	}
+}
+
+std::size_t
+dvl::heatmap::line_of(long offset)
+	const
+{
+	auto it = std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+
+	return it == line_starts.begin() ? 0 : it - line_starts.begin() - 1;
+}
+
+std::vector<dvl::heatmap::line>
+dvl::heatmap::lines()
+	const
+{
+	std::vector<line> r;
+
+	for(std::size_t l = 0; l < line_starts.size(); l++)
+	{
+		line ln{l + 1, line_starts[l], l + 1 < line_starts.size() ? line_starts[l + 1] : (long) reads.size(),
+			0, 0, sorted(rewound[l])};
+
+		for(long o = ln.start; o < ln.end; o++)
+		{
+			ln.reads += reads[o];
+			ln.rereads += reads[o] > 1 ? reads[o] - 1 : 0;
+		}
+
+		r.push_back(ln);
+	}
+
+	return r;
+}
+
+std::vector<dvl::heatmap::region>
+dvl::heatmap::hot_regions(uint32_t min_reads)
+	const
+{
+	std::vector<region> r;
+
+	min_reads = std::max(min_reads, (uint32_t) 2);
+
+	for(long o = 0; o < (long) reads.size();)
+	{
+		if(reads[o] < min_reads)
+		{
+			o++;
+			continue;
+		}
+
+		region reg{o, o, line_of(o) + 1, 0, 0, {}};
+
+		for(; reg.end < (long) reads.size() && reads[reg.end] >= min_reads; reg.end++)
+			reg.rereads += reads[reg.end] - 1;
+
+		reg.last_line = line_of(reg.end - 1) + 1;
+
+		std::unordered_map<uint64_t, uint64_t> c;
+		for(std::size_t l = reg.first_line - 1; l < reg.last_line; l++)
+			for(auto &e : rewound[l])
+				c[e.first] += e.second;
+
+		reg.responsible = sorted(c);
+
+		r.push_back(reg);
+		o = reg.end;
+	}
+
+	std::stable_sort(r.begin(), r.end(), [](const region &a, const region &b){
+		return a.rereads > b.rereads;
+	});
+
+	return r;
+}
+
+void
+dvl::heatmap::write(std::wostream &out, pid_table &pt, uint32_t min_reads)
+	const
+{
+	static const std::size_t WIDTH = 32, RESPONSIBLE = 3;
+
+	auto put_charges = [&](const charges &c){
+		for(std::size_t i = 0; i < c.size() && i < RESPONSIBLE; i++)
+			out << L' ' << pt.to_string(c[i].first) << L'(' << c[i].second << L')';
+	};
+
+	std::vector<line> ls = lines();
+
+	uint64_t total = 0, rereads = 0, max = 0;
+	for(const line &l : ls)
+	{
+		total += l.reads;
+		rereads += l.rereads;
+		max = std::max(max, l.rereads);
+	}
+
+	out << reads.size() << L" characters, " << total << L" reads, " << rereads << L" rereads\n";
+
+	// histogram of the lines with rereads
+	for(const line &l : ls)
+	{
+		if(l.rereads == 0)
+			continue;
+
+		std::size_t bar = std::max((std::size_t) 1, (std::size_t) (l.rereads * WIDTH / max));
+
+		out << std::right << std::setw(6) << l.number << L' ' << std::setw(8) << l.rereads << L' '
+				<< std::left << std::setw(WIDTH) << std::wstring(bar, L'#');
+		put_charges(l.responsible);
+		out << L'\n';
+	}
+
+	std::vector<region> hot = hot_regions(min_reads);
+
+	if(!hot.empty())
+		out << L"hot regions\n";
+
+	for(const region &r : hot)
+	{
+		out << L"  [" << r.start << L", " << r.end << L") lines " << r.first_line << L'-' << r.last_line
+				<< L", " << r.rereads << L" rereads:";
+		put_charges(r.responsible);
+		out << L'\n';
+	}
+
+	out << std::right;
+}
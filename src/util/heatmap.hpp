@@ -0,0 +1,150 @@
+#ifndef UTIL_HEATMAP_HPP_
+#define UTIL_HEATMAP_HPP_
+
+#include "../id/pid.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// heatmap
+	//
+
+	/**
+	 * Counts how often the parser reads each offset of the input. Any character read
+	 * more than once was discarded by a routine that rewound the input, usually a failing
+	 * alternative, and thus marks input where memoization or a refactoring of the grammar
+	 * pays off.
+	 *
+	 * The parser doesn't count single reads. Instead the input read since the last movement
+	 * of the input-stream is counted, whenever the stream is rewound and once the parser
+	 * completes. The routine rewinding the input is charged with the characters it rewound,
+	 * attributed to the lines of the input (see lines()).
+	 *
+	 * @see parser_context::heat
+	 */
+	class heatmap
+	{
+	public:
+		/**
+		 * routines charged with rewound characters, sorted by the number of characters
+		 */
+		typedef std::vector<std::pair<pid, uint64_t>> charges;
+
+		struct line
+		{
+			/**
+			 * number of the line, starting at 1
+			 */
+			std::size_t number;
+
+			/**
+			 * offsets of the first character and the end (exclusive) of the line
+			 */
+			long start, end;
+
+			uint64_t reads;
+
+			/**
+			 * reads of characters that were read before
+			 */
+			uint64_t rereads;
+
+			charges responsible;
+		};
+
+		struct region
+		{
+			/**
+			 * offsets of the first character and the end (exclusive) of the region
+			 */
+			long start, end;
+
+			/**
+			 * the lines spanned by the region
+			 */
+			std::size_t first_line, last_line;
+
+			uint64_t rereads;
+
+			/**
+			 * routines charged within the lines spanned by the region
+			 */
+			charges responsible;
+		};
+	private:
+		std::vector<uint32_t> reads;
+
+		/**
+		 * offsets of the first character of each line
+		 */
+		std::vector<long> line_starts;
+
+		/**
+		 * characters rewound per line and routine
+		 */
+		std::vector<std::unordered_map<uint64_t, uint64_t>> rewound;
+
+		charges sorted(const std::unordered_map<uint64_t, uint64_t> &c) const;
+	public:
+		/**
+		 * Builds the newline-index of the input and resets all counters
+		 *
+		 * @param input the input of the parser
+		 */
+		void index(const std::wstring &input);
+
+		/**
+		 * Counts a read of each offset in [first, last)
+		 */
+		void consume(long first, long last);
+
+		/**
+		 * Charges the routine with rewinding the input from last to first
+		 */
+		void rewind(long first, long last, const pid &id);
+
+		/**
+		 * @return the number of reads of the character at the offset
+		 */
+		uint32_t count(long offset) const
+		{
+			return offset >= 0 && (std::size_t) offset < reads.size() ? reads[offset] : 0;
+		}
+
+		/**
+		 * @return the index of the line containing the offset, starting at 0
+		 */
+		std::size_t line_of(long offset) const;
+
+		/**
+		 * @return one entry per line of the input
+		 */
+		std::vector<line> lines() const;
+
+		/**
+		 * Finds maximal ranges of characters read at least min_reads times
+		 *
+		 * @param min_reads the minimum number of reads of each character of a region
+		 * @return the regions sorted by the number of rereads
+		 */
+		std::vector<region> hot_regions(uint32_t min_reads = 2) const;
+
+		/**
+		 * Writes a histogram of the lines with rereads followed by the hot regions
+		 *
+		 * @param out the stream to write to
+		 * @param pt table used to resolve the names of pids
+		 * @param min_reads see hot_regions(uint32_t)
+		 */
+		void write(std::wostream &out, pid_table &pt, uint32_t min_reads = 2) const;
+	};
+}
+
+#endif /* UTIL_HEATMAP_HPP_ */
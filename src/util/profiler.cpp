@@ -0,0 +1,167 @@
+#include "profiler.hpp"
+#include "escape.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+	/**
+	 * writes str as quoted string of a CSV-file
+	 */
+	void put_quoted(std::wostream &out, const std::wstring &str)
+	{
+		out << L'"';
+
+		for(wchar_t c : str)
+		{
+			if(c == L'"')
+				out << L"\"\"";
+			else
+				out << c;
+		}
+
+		out << L'"';
+	}
+}
+
+void
+dvl::profiler::counters::add(const counters &c)
+{
+	invocations += c.invocations;
+	successes += c.successes;
+	failures += c.failures;
+	repeats += c.repeats;
+	consumed += c.consumed;
+	rewound += c.rewound;
+	inclusive += c.inclusive;
+	exclusive += c.exclusive;
+}
+
+dvl::profiler::counters&
+dvl::profiler::get_unindexed(const pid &id)
+{
+	auto it = unindexed_pos.emplace(id, unindexed.size());
+	if(it.second)
+	{
+		unindexed.emplace_back();
+		unindexed.back().id = id;
+	}
+
+	return unindexed[it.first->second];
+}
+
+void
+dvl::profiler::reset()
+{
+	routines.clear();
+	unindexed.clear();
+	unindexed_pos.clear();
+}
+
+std::vector<dvl::profiler::counters>
+dvl::profiler::report()
+	const
+{
+	std::vector<counters> r;
+	std::unordered_map<uint64_t, std::size_t> pos;
+
+	auto merge = [&](const std::vector<counters> &cs){
+		for(const counters &c : cs)
+		{
+			// routines that never ran
+			if(c.invocations == 0)
+				continue;
+
+			auto it = pos.emplace(c.id, r.size());
+			if(it.second)
+			{
+				r.emplace_back();
+				r.back().id = c.id;
+			}
+
+			r[it.first->second].add(c);
+		}
+	};
+
+	merge(routines);
+	merge(unindexed);
+
+	std::stable_sort(r.begin(), r.end(), [](const counters &a, const counters &b){
+		return a.exclusive > b.exclusive;
+	});
+
+	return r;
+}
+
+void
+dvl::profiler::write(std::wostream &out, pid_table &pt, format fmt)
+	const
+{
+	static const wchar_t *columns[] = {L"invocations", L"successes", L"failures", L"repeats",
+			L"consumed", L"rewound", L"inclusive", L"exclusive"};
+
+	std::vector<counters> r = report();
+
+	auto values = [](const counters &c){
+		return std::vector<uint64_t>{c.invocations, c.successes, c.failures, c.repeats,
+			c.consumed, c.rewound, c.inclusive, c.exclusive};
+	};
+
+	switch(fmt)
+	{
+	case format::TEXT:
+	{
+		std::size_t width = 4;
+		for(const counters &c : r)
+			width = std::max(width, pt.to_string(c.id).length());
+
+		out << std::left << std::setw(width) << L"name";
+		for(const wchar_t *col : columns)
+			out << L' ' << std::right << std::setw(12) << col;
+		out << L'\n';
+
+		for(const counters &c : r)
+		{
+			out << std::left << std::setw(width) << pt.to_string(c.id);
+			for(uint64_t v : values(c))
+				out << L' ' << std::right << std::setw(12) << v;
+			out << L'\n';
+		}
+
+		break;
+	}
+	case format::CSV:
+		out << L"name";
+		for(const wchar_t *col : columns)
+			out << L',' << col;
+		out << L'\n';
+
+		for(const counters &c : r)
+		{
+			put_quoted(out, pt.to_string(c.id));
+			for(uint64_t v : values(c))
+				out << L',' << v;
+			out << L'\n';
+		}
+
+		break;
+	case format::JSON:
+		out << L'[';
+
+		for(std::size_t i = 0; i < r.size(); i++)
+		{
+			out << (i > 0 ? L",{" : L"{") << L"\"name\":";
+			put_json_string(out, pt.to_string(r[i].id));
+
+			std::vector<uint64_t> v = values(r[i]);
+			for(std::size_t j = 0; j < v.size(); j++)
+				out << L",\"" << columns[j] << L"\":" << v[j];
+
+			out << L'}';
+		}
+
+		out << L"]\n";
+		break;
+	}
+}
@@ -0,0 +1,150 @@
+#ifndef UTIL_PROFILER_HPP_
+#define UTIL_PROFILER_HPP_
+
+#include "../id/pid.hpp"
+#include "../syntax/routines.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// profiler
+	//
+
+	/**
+	 * Per-routine counters of a parser. The counters are kept in a flat array indexed by the
+	 * dense index of the routine (see grammar_index), routines without index share one entry
+	 * per pid. A parser only collects counters, if a profiler is set in its context, otherwise
+	 * the profiling code is compiled out of its main loop.
+	 *
+	 * Times are measured in ticks of the time-stamp counter, if available, otherwise in ticks
+	 * of std::chrono::steady_clock. The inclusive time of a routine spans from its first run to
+	 * its completion or failure, the exclusive time excludes the inclusive time of its children.
+	 *
+	 * Reports aggregate the counters of all routines with the same pid and are sorted by
+	 * exclusive time. Supported formats are
+	 * <ul>
+	 * 	<li>TEXT: a table with one row per pid</li>
+	 * 	<li>CSV: a header followed by one line per pid</li>
+	 * 	<li>JSON: an array with one object per pid</li>
+	 * </ul>
+	 *
+	 * @see parser_context::prof
+	 */
+	class profiler
+	{
+	public:
+		enum class format
+		{
+			TEXT,
+			CSV,
+			JSON
+		};
+
+		struct counters
+		{
+			pid id;
+
+			uint64_t invocations = 0;
+			uint64_t successes = 0;
+			uint64_t failures = 0;
+
+			/**
+			 * runs of the routine after its first run
+			 */
+			uint64_t repeats = 0;
+
+			/**
+			 * characters consumed by successful runs
+			 */
+			uint64_t consumed = 0;
+
+			/**
+			 * characters the input was rewound by failures of the routine
+			 */
+			uint64_t rewound = 0;
+
+			uint64_t inclusive = 0;
+			uint64_t exclusive = 0;
+
+			void add(const counters &c);
+		};
+	private:
+		std::vector<counters> routines;
+
+		/**
+		 * entries of routines without index
+		 */
+		std::vector<counters> unindexed;
+		std::unordered_map<uint64_t, std::size_t> unindexed_pos;
+
+		counters &get_unindexed(const pid &id);
+	public:
+		/**
+		 * @param routine_count the number of routines of the profiled grammar, used to
+		 * 		preallocate the counters
+		 */
+		profiler(std::size_t routine_count = 0){ routines.reserve(routine_count); }
+
+		/**
+		 * @param index the dense index of a routine or routine::NO_INDEX
+		 * @param id the pid of the routine
+		 * @return the counters of the routine
+		 */
+		counters &get(std::size_t index, const pid &id)
+		{
+			if(index >= routines.size())
+			{
+				if(index == routine::NO_INDEX)
+					return get_unindexed(id);
+
+				routines.resize(index + 1);
+			}
+
+			routines[index].id = id;
+			return routines[index];
+		}
+
+		/**
+		 * Discards all counters
+		 */
+		void reset();
+
+		/**
+		 * @return the counters aggregated by pid, sorted by exclusive time
+		 */
+		std::vector<counters> report() const;
+
+		/**
+		 * Writes the report in the specified format
+		 *
+		 * @param out the stream to write to
+		 * @param pt table used to resolve the names of pids
+		 * @param fmt the format of the report
+		 */
+		void write(std::wostream &out, pid_table &pt, format fmt = format::TEXT) const;
+
+		/**
+		 * @return the current value of the clock used for measurements
+		 */
+		static uint64_t ticks()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+		}
+	};
+}
+
+#endif /* UTIL_PROFILER_HPP_ */
@@ -0,0 +1,126 @@
+#include "sampler.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <sys/time.h>
+#define SAMPLER_SIGNALS
+#endif
+
+namespace
+{
+#ifdef SAMPLER_SIGNALS
+	/**
+	 * handler of SIGPROF prior to the start of the active sampler
+	 */
+	struct sigaction previous;
+#endif
+
+	/**
+	 * writes the name of a frame, replacing the separators of the folded-stacks format
+	 */
+	void put_frame(std::wostream &out, const std::wstring &name)
+	{
+		for(wchar_t c : name)
+			out << (c == L';' || c == L' ' ? L'_' : c);
+	}
+}
+
+std::atomic<dvl::stack_sampler*> dvl::stack_sampler::active{nullptr};
+
+void
+dvl::stack_sampler::on_signal(int)
+{
+	stack_sampler *s = active.load(std::memory_order_relaxed);
+
+	if(s != nullptr)
+		s->request();
+}
+
+void
+dvl::stack_sampler::record(const std::vector<pid> &stack)
+{
+	requested.store(false, std::memory_order_relaxed);
+
+	stacks[std::vector<uint64_t>(stack.begin(), stack.end())]++;
+	samples++;
+}
+
+void
+dvl::stack_sampler::reset()
+{
+	stacks.clear();
+	samples = 0;
+}
+
+bool
+dvl::stack_sampler::start(std::chrono::microseconds interval)
+{
+#ifdef SAMPLER_SIGNALS
+	if(interval.count() <= 0)
+		return false;
+
+	stack_sampler *expected = nullptr;
+	if(!active.compare_exchange_strong(expected, this))
+		return false;
+
+	struct sigaction sa = {};
+	sa.sa_handler = &stack_sampler::on_signal;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+
+	struct itimerval timer = {};
+	timer.it_interval.tv_sec = interval.count() / 1000000;
+	timer.it_interval.tv_usec = interval.count() % 1000000;
+	timer.it_value = timer.it_interval;
+
+	if(sigaction(SIGPROF, &sa, &previous) != 0)
+	{
+		active.store(nullptr);
+		return false;
+	}
+
+	if(setitimer(ITIMER_PROF, &timer, nullptr) != 0)
+	{
+		sigaction(SIGPROF, &previous, nullptr);
+		active.store(nullptr);
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void
+dvl::stack_sampler::stop()
+{
+#ifdef SAMPLER_SIGNALS
+	if(active.load() != this)
+		return;
+
+	struct itimerval timer = {};
+	setitimer(ITIMER_PROF, &timer, nullptr);
+	sigaction(SIGPROF, &previous, nullptr);
+
+	active.store(nullptr);
+#endif
+}
+
+void
+dvl::stack_sampler::write(std::wostream &out, pid_table &pt)
+	const
+{
+	for(auto &s : stacks)
+	{
+		for(std::size_t i = 0; i < s.first.size(); i++)
+		{
+			if(i > 0)
+				out << L';';
+
+			put_frame(out, pt.to_string(s.first[i]));
+		}
+
+		out << L' ' << s.second << L'\n';
+	}
+}
@@ -0,0 +1,113 @@
+#ifndef UTIL_SAMPLER_HPP_
+#define UTIL_SAMPLER_HPP_
+
+#include "../id/pid.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// stack_sampler
+	//
+
+	/**
+	 * Sampling profiler of the routine-stack of a parser. A sample is requested by setting a
+	 * lock-free flag, either via request() from any thread or periodically by a timer-signal
+	 * (see start(std::chrono::microseconds)). The parser polls the flag before each step and
+	 * records the pids on its stack from the bottom frame up. Thus the stack is never
+	 * inspected while the parser modifies it and the signal-handler only stores the flag.
+	 *
+	 * Identical stacks are aggregated. write(std::wostream&, pid_table&) produces the
+	 * folded-stacks format, one line per stack with the names of the routines separated by
+	 * semicolons followed by the number of samples, which can be processed by flame graph
+	 * tools.
+	 *
+	 * A sampler must only be used by one parser at a time.
+	 *
+	 * @see parser_context::sampler
+	 */
+	class stack_sampler
+	{
+	private:
+		std::atomic<bool> requested{false};
+
+		/**
+		 * number of samples per stack, keyed by the pids from the bottom frame up
+		 */
+		std::map<std::vector<uint64_t>, uint64_t> stacks;
+
+		uint64_t samples = 0;
+
+		/**
+		 * the sampler receiving the timer-signal
+		 */
+		static std::atomic<stack_sampler*> active;
+
+		static void on_signal(int);
+	public:
+		stack_sampler(){}
+
+		stack_sampler(const stack_sampler&) = delete;
+
+		~stack_sampler(){ stop(); }
+
+		/**
+		 * Requests a sample at the next step of the parser. Async-signal-safe.
+		 */
+		void request(){ requested.store(true, std::memory_order_relaxed); }
+
+		/**
+		 * @return true if a sample was requested
+		 */
+		bool pending() const { return requested.load(std::memory_order_relaxed); }
+
+		/**
+		 * Records a sample and clears the request
+		 *
+		 * @param stack the pids on the stack from the bottom frame up
+		 */
+		void record(const std::vector<pid> &stack);
+
+		uint64_t get_samples() const { return samples; }
+
+		/**
+		 * @return the number of samples per stack
+		 */
+		const std::map<std::vector<uint64_t>, uint64_t> &get_stacks() const { return stacks; }
+
+		/**
+		 * Discards all samples
+		 */
+		void reset();
+
+		/**
+		 * Requests samples periodically via SIGPROF, thus in intervals of CPU-time of the
+		 * process. Only one sampler can be started at a time.
+		 *
+		 * @param interval the interval between two samples
+		 * @return false if another sampler is running or the timer couldn't be installed
+		 */
+		bool start(std::chrono::microseconds interval);
+
+		/**
+		 * Stops the timer, if this sampler was started
+		 */
+		void stop();
+
+		/**
+		 * Writes the samples in folded-stacks format
+		 *
+		 * @param out the stream to write to
+		 * @param pt table used to resolve the names of pids
+		 */
+		void write(std::wostream &out, pid_table &pt) const;
+	};
+}
+
+#endif /* UTIL_SAMPLER_HPP_ */
@@ -0,0 +1,53 @@
+#include "scan.hpp"
+
+#include <cwchar>
+
+#if defined(__SSE2__) && WCHAR_MAX > 0xFFFF
+	#define __SCAN_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const wchar_t *find_first_of_scalar(const wchar_t *begin, const wchar_t *end, const wchar_t *set, std::size_t n)
+	{
+		for(; begin < end; begin++)
+			for(std::size_t i = 0; i < n; i++)
+				if(*begin == set[i])
+					return begin;
+
+		return end;
+	}
+}
+
+const wchar_t*
+util::find_first_of(const wchar_t *begin, const wchar_t *end, const wchar_t *set, std::size_t n)
+{
+	if(n == 0)
+		return end;
+
+#ifdef __SCAN_SSE2
+	if(n <= VECTOR_SET_MAX)
+	{
+		__m128i needles[VECTOR_SET_MAX];
+		for(std::size_t i = 0; i < n; i++)
+			needles[i] = _mm_set1_epi32((int) set[i]);
+
+		// compare four characters at a time against each character of the set
+		for(; end - begin >= 4; begin += 4)
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i*) begin);
+			__m128i hit = _mm_cmpeq_epi32(chunk, needles[0]);
+
+			for(std::size_t i = 1; i < n; i++)
+				hit = _mm_or_si128(hit, _mm_cmpeq_epi32(chunk, needles[i]));
+
+			int mask = _mm_movemask_epi8(hit);
+			if(mask != 0)
+				return begin + (__builtin_ctz(mask) >> 2);
+		}
+	}
+#endif
+
+	return find_first_of_scalar(begin, end, set, n);
+}
@@ -0,0 +1,28 @@
+#ifndef UTIL_SCAN_HPP_
+#define UTIL_SCAN_HPP_
+
+#include <cstddef>
+
+namespace util
+{
+	/**
+	 * Maximum number of characters for which find_first_of uses the vectorized search.
+	 * Larger sets will be searched character by character.
+	 */
+	constexpr std::size_t VECTOR_SET_MAX = 8;
+
+	/**
+	 * Searches [begin, end) for the first character contained in set. If SSE2 is available
+	 * and wchar_t is 32 bits wide, the input is compared against all characters of the set
+	 * four characters at a time (similar to memchr).
+	 *
+	 * @param begin the start of the input
+	 * @param end the end of the input (exclusive)
+	 * @param set the characters to search for
+	 * @param n the number of characters in set
+	 * @return pointer to the first matching character or end if no character matches
+	 */
+	const wchar_t *find_first_of(const wchar_t *begin, const wchar_t *end, const wchar_t *set, std::size_t n);
+}
+
+#endif /* UTIL_SCAN_HPP_ */
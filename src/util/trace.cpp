@@ -0,0 +1,110 @@
+#include "trace.hpp"
+#include "escape.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+dvl::trace_recorder::trace_recorder(std::size_t capacity, std::size_t chunk):
+	events(new event[capacity]()),
+	capacity(capacity),
+	chunk(std::max(chunk, (std::size_t) 1)),
+	epoch(std::chrono::steady_clock::now())
+{}
+
+bool
+dvl::trace_recorder::claim(writer &w)
+{
+	std::size_t start = next.fetch_add(chunk, std::memory_order_relaxed);
+
+	if(start >= capacity)
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	w.cur = events.get() + start;
+	w.last = events.get() + std::min(start + chunk, capacity);
+
+	return true;
+}
+
+std::vector<dvl::trace_recorder::event>
+dvl::trace_recorder::get_events()
+	const
+{
+	std::vector<event> r;
+
+	for(std::size_t i = 0; i < std::min(next.load(), capacity); i++)
+		if(events[i].k != kind::NONE)
+			r.push_back(events[i]);
+
+	// chunks of different writers interleave
+	std::stable_sort(r.begin(), r.end(), [](const event &a, const event &b){ return a.tid < b.tid; });
+
+	return r;
+}
+
+void
+dvl::trace_recorder::write(std::wostream &out, pid_table &pt)
+	const
+{
+	bool first = true;
+
+	auto begin = [&](const wchar_t *ph, uint32_t tid){
+		out << (first ? L"\n" : L",\n") << L"{\"ph\":\"" << ph << L"\",\"pid\":1,\"tid\":" << tid;
+		first = false;
+	};
+
+	out << L"{\"traceEvents\":[";
+
+	for(uint32_t tid = 0; tid < writers.load(); tid++)
+	{
+		begin(L"M", tid);
+		out << L",\"name\":\"thread_name\",\"args\":{\"name\":\"parser " << tid << L"\"}}";
+	}
+
+	std::streamsize precision = out.precision(3);
+	out << std::fixed;
+
+	for(std::size_t i = 0; i < std::min(next.load(), capacity); i++)
+	{
+		const event &e = events[i];
+
+		switch(e.k)
+		{
+		case kind::NONE:
+			continue;
+		case kind::BEGIN:
+			begin(L"B", e.tid);
+			out << L",\"cat\":\"routine\"";
+			break;
+		case kind::END:
+		case kind::FAIL:
+			begin(L"E", e.tid);
+			break;
+		case kind::BACKTRACK:
+			begin(L"i", e.tid);
+			out << L",\"s\":\"t\",\"cat\":\"backtrack\"";
+			break;
+		case kind::MEMO_HIT:
+			begin(L"i", e.tid);
+			out << L",\"s\":\"t\",\"cat\":\"memo\"";
+			break;
+		}
+
+		out << L",\"name\":";
+		put_json_string(out, pt.to_string(e.id));
+		out << L",\"ts\":" << e.ts / 1000.0 << L",\"args\":{\"offset\":" << e.offset;
+
+		if(e.k == kind::BACKTRACK)
+			out << L",\"from\":" << e.end;
+		else if(e.k == kind::END || e.k == kind::FAIL)
+			out << L",\"matched\":" << (e.k == kind::END ? L"true" : L"false");
+
+		out << L"}}";
+	}
+
+	out << L"\n]}\n";
+	out.unsetf(std::ios::floatfield);
+	out.precision(precision);
+}
@@ -0,0 +1,165 @@
+#ifndef UTIL_TRACE_HPP_
+#define UTIL_TRACE_HPP_
+
+#include "../id/pid.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace dvl
+{
+	////////////////////////////////////////////////////////////////////////////
+	// trace_recorder
+	//
+
+	/**
+	 * Records the execution of parsers as a timeline of events and exports it in the
+	 * trace-event format of Chrome (chrome://tracing, Perfetto).
+	 *
+	 * All events are stored in a buffer allocated on construction. Each parser records via
+	 * its own writer, which claims chunks of the buffer via an atomic counter and fills them
+	 * without any synchronization. Thus parsers running in parallel can share a recorder. If
+	 * the buffer is exhausted, further events are dropped and counted.
+	 *
+	 * Each writer appears as a separate thread in the trace. Routines are shown as slices
+	 * from their first run to their completion or failure, rewinds of the input and hits of
+	 * memoized results as instant events.
+	 *
+	 * The recorder must only be exported once no writer records anymore.
+	 *
+	 * @see parser_context::trace
+	 */
+	class trace_recorder
+	{
+	public:
+		enum class kind : uint8_t
+		{
+			/**
+			 * unused slot of the buffer
+			 */
+			NONE,
+			BEGIN,
+			END,
+			FAIL,
+			BACKTRACK,
+			MEMO_HIT
+		};
+
+		struct event
+		{
+			/**
+			 * nanoseconds since construction of the recorder
+			 */
+			uint64_t ts;
+
+			uint64_t id;
+
+			/**
+			 * offset of the input, BACKTRACK-events rewind from end to offset
+			 */
+			long offset, end;
+
+			uint32_t tid;
+
+			kind k;
+		};
+
+		/**
+		 * Appends events to the buffer of a recorder. A writer must only be used by one
+		 * thread at a time.
+		 */
+		class writer
+		{
+			friend class trace_recorder;
+		private:
+			trace_recorder *r = nullptr;
+
+			/**
+			 * the unused part of the chunk claimed last
+			 */
+			event *cur = nullptr, *last = nullptr;
+
+			uint32_t tid = 0;
+
+			writer(trace_recorder &r, uint32_t tid): r(&r), tid(tid){}
+		public:
+			writer(){}
+
+			/**
+			 * Records an event at the current time. Dropped, if the buffer is exhausted.
+			 */
+			void record(kind k, const pid &id, long offset, long end = -1)
+			{
+				if(cur == last && !r->claim(*this))
+					return;
+
+				*cur++ = {r->now(), id, offset, end, tid, k};
+			}
+		};
+	private:
+		std::unique_ptr<event[]> events;
+
+		std::size_t capacity, chunk;
+
+		/**
+		 * start of the next chunk to claim
+		 */
+		std::atomic<std::size_t> next{0};
+
+		std::atomic<uint32_t> writers{0};
+
+		std::atomic<uint64_t> dropped{0};
+
+		std::chrono::steady_clock::time_point epoch;
+
+		/**
+		 * Claims a new chunk for the writer
+		 *
+		 * @return false if the buffer is exhausted
+		 */
+		bool claim(writer &w);
+
+		uint64_t now() const
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+		}
+	public:
+		/**
+		 * @param capacity the maximum number of events
+		 * @param chunk the number of events claimed by a writer at once
+		 */
+		trace_recorder(std::size_t capacity = 1 << 20, std::size_t chunk = 1024);
+
+		trace_recorder(const trace_recorder&) = delete;
+
+		/**
+		 * @return a writer appearing as a new thread in the trace
+		 */
+		writer get_writer(){ return writer(*this, writers++); }
+
+		/**
+		 * @return the number of events dropped due to an exhausted buffer
+		 */
+		uint64_t get_dropped() const { return dropped.load(); }
+
+		/**
+		 * @return the recorded events ordered by writer, the events of each writer in
+		 * 		order of recording
+		 */
+		std::vector<event> get_events() const;
+
+		/**
+		 * Writes all events as trace-event JSON
+		 *
+		 * @param out the stream to write to
+		 * @param pt table used to resolve the names of pids
+		 */
+		void write(std::wostream &out, pid_table &pt) const;
+	};
+}
+
+#endif /* UTIL_TRACE_HPP_ */